@@ -0,0 +1,13 @@
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+#pragma once
+
+#include <cstdint>
+
+// Heap allocations made through operator new since program start. Counting
+// replaces the global operator new and is compiled in only when
+// POLYRENDER_COUNT_ALLOCS is defined, otherwise this always returns 0.
+uint64_t allocation_count();
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#pragma once
+
+#include "Render_math.hpp"
+
+#include <vector>
+#include <array>
+#include <map>
+#include <string>
+#include <utility>
+#include <cstdio>
+#include <cstdint>
+
+class Renderer;
+
+// Mesh data stored once per capture
+struct Capture_mesh {
+    std::vector<Vec3> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Vec3> normals;
+    std::vector<uint32_t> colors;
+};
+
+// Object drawn in a captured frame
+struct Capture_object {
+    uint32_t mesh;     // Index into Capture::meshes
+    Mat4 model;        // Model matrix
+    uint32_t color = 0xFFFFFFFF; // Fill color
+};
+
+// Scene state of a single frame
+struct Capture_frame {
+    Mat4 view;
+    Mat4 projection;
+    uint32_t clear_color = 0;
+    int ssaa_factor = 1;
+    float render_scale = 1.0f;
+    int render_mode = 0;   // Renderer::Render_mode
+    int shade_mode = 1;    // Renderer::Shade_mode
+    Vec3 light_dir = Vec3(-0.3f, -0.5f, -1.0f).norm();
+    float ambient = 0.2f;
+    std::vector<Capture_object> objects;
+};
+
+// Capture loaded into memory for replay
+struct Capture {
+    int width = 0;
+    int height = 0;
+    int ssaa_factor = 1;
+    std::vector<Capture_mesh> meshes;
+    std::vector<Capture_frame> frames;
+
+    // Load capture file, returns false on a missing or malformed file
+    bool load(const std::string& path);
+};
+
+// Records the scene state of a renderer every frame into a capture file.
+// Meshes are identified by the storage of their vertices, indices, normals and
+// colors and written the first time an object using them is recorded. A content
+// hash is kept per storage and checked once per frame, so meshes edited in place
+// or freed and reallocated at the same address are written again under a new id.
+class Capture_writer {
+public:
+    Capture_writer() = default;
+    ~Capture_writer();
+
+    Capture_writer(const Capture_writer&) = delete;
+    Capture_writer& operator=(const Capture_writer&) = delete;
+
+    // Open capture file and write header for renderer, returns false if the file can't be opened
+    bool open(const std::string& path, const Renderer& renderer);
+
+    // Record camera, projection and objects of the current frame
+    void record_frame(const Renderer& renderer);
+
+    // Flush and close capture file
+    void close();
+
+    bool is_open() const { return file != nullptr; }
+
+    // Number of frames recorded
+    uint32_t get_frame_count() const { return frame_count; }
+
+private:
+    FILE* file = nullptr;
+    uint32_t frame_count = 0;
+    // Mesh written for a storage, by vertex or quantized, index, normal and color storage
+    struct Recorded_mesh {
+        uint32_t id;
+        uint64_t hash;           // Content hash when it was written
+        uint32_t frame;          // Last frame the hash was checked in
+    };
+    std::map<std::array<const void*, 4>, Recorded_mesh> mesh_ids;
+    uint32_t mesh_count = 0;     // Mesh chunks written
+    std::vector<uint32_t> frame_ids;  // Mesh id of each object of the frame being recorded
+    std::vector<uint8_t> chunk;  // Reused chunk payload
+
+    void write_chunk(uint32_t tag);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef COMMAND_BUFFER_HPP
+#define COMMAND_BUFFER_HPP
+
+#pragma once
+
+#include "Render_math.hpp"
+#include "Renderable.hpp"
+#include "Renderer.hpp"
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Pipeline state a draw is executed with
+struct Draw_state {
+    Renderer::Render_mode mode = Renderer::Render_mode::Filled;
+    Renderer::Shade_mode shade = Renderer::Shade_mode::Gouraud;
+};
+
+// Single recorded draw
+struct Draw_command {
+    const Renderable* mesh;
+    Mat4 model;
+    Draw_state state;
+};
+
+// Draw commands recorded by one thread, no locking
+class Command_list {
+public:
+    // Record draw with an explicit model matrix
+    void draw(const Renderable& mesh, const Mat4& model, Draw_state state = Draw_state());
+
+    // Record draw with the mesh's own model matrix
+    void draw(const Renderable& mesh, Draw_state state = Draw_state());
+
+    // Remove all commands, keeps capacity
+    void reset();
+
+    const std::vector<Draw_command>& get_commands() const { return commands; }
+
+private:
+    std::vector<Draw_command> commands;
+};
+
+// Per thread command lists merged and sorted before execution. Commands are
+// ordered by pipeline state first to minimize state changes, then front to back
+// by view depth for early depth rejection. Ties keep recording order, lists
+// merged in index order, so the result is deterministic for any thread timing.
+class Command_buffer {
+public:
+    explicit Command_buffer(size_t list_count = 1);
+
+    // List for recording thread index, each thread must use its own list
+    Command_list& list(size_t index) { return lists[index]; }
+
+    size_t get_list_count() const { return lists.size(); }
+
+    // Reset all lists for the next frame
+    void reset();
+
+    // Merge, sort and execute all lists on renderer
+    void submit(Renderer& renderer);
+
+private:
+    std::vector<Command_list> lists;
+    std::vector<std::pair<uint64_t, const Draw_command*>> sorted; // Reused between frames
+    std::vector<Renderer::Draw_item> items;                       // Reused between frames
+
+    // Sort key of a command, state in the high bits, then depth, then sequence number
+    static uint64_t make_key(const Draw_command& command, const Mat4& view, uint32_t sequence);
+};
+
+#endif
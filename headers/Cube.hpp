@@ -5,6 +5,7 @@
 
 #include "Render_math.hpp"
 #include "Renderable.hpp"
+#include "Mesh_cache.hpp"
 
 #include <vector>
 #include <cstdint>
@@ -23,6 +24,15 @@ public:
     // Get Model matrix
     const Mat4 get_model_matrix() const override;
 
+    // Returns ARGB fill color
+    uint32_t get_color() const override;
+
+    // Returns per face texture coordinates
+    const std::vector<Vec2>& get_uvs() const override;
+
+    // Returns unit box bounds
+    Aabb get_bounds() const override;
+
     // SETTERS
     // Set position Vec3 {x, y, z}
     void set_position(const Vec3& _pos);
@@ -33,13 +43,19 @@ public:
     // Set scale Vec3 {x scale, y scale, z scale}
     void set_scale(const Vec3& _scale);
 
+    // Set ARGB fill color
+    void set_color(uint32_t _color);
+
 protected:
-    std::vector<Vec3> vertices;
-    std::vector<uint32_t> indices;
+    Mesh_cache::Handle mesh; // Unit cube shared by every Cube
 
     Vec3 pos = {0, 0, 0};
     Vec3 rot = {0, 0, 0}; // Euler angles
     Vec3 scale = {1, 1, 1};
+    uint32_t color = 0xFFFFFFFF;
+
+    // Generates vertices, texture coordinates and indices of the unit cube
+    static Mesh_data generate_mesh();
 
 };
 
@@ -0,0 +1,61 @@
+#ifndef FRAME_CONTROLLER_HPP
+#define FRAME_CONTROLLER_HPP
+
+#pragma once
+
+#include <vector>
+#include <array>
+
+class Renderer;
+
+// Adjusts render scale and SSAA factor between frames to hold a frame time budget.
+// Quality levels are ordered from cheapest to most expensive, their relative cost
+// is the number of samples rendered per window pixel.
+class Frame_controller {
+public:
+    // Quality level the controller can select
+    struct Level {
+        float render_scale;
+        int ssaa_factor;
+        float cost() const { return render_scale * render_scale * ssaa_factor * ssaa_factor; }
+    };
+
+    // target_ms is the frame budget, max_ssaa the highest SSAA factor allowed
+    Frame_controller(double target_ms, int max_ssaa = 4);
+
+    // Record time of the last frame, returns true if the quality level changed
+    bool update(double frame_ms);
+
+    // Apply current quality level to a renderer
+    void apply(Renderer& renderer) const;
+
+    // Preallocate renderer buffers for the most expensive level
+    void reserve(Renderer& renderer) const;
+
+    // GETTERS
+    double get_target_ms() const { return target_ms; }
+    const Level& get_level() const { return levels[level]; }
+
+    // Average of the recent frame times
+    double get_average_ms() const;
+
+    // SETTERS
+    void set_target_ms(double _target_ms) { target_ms = _target_ms; }
+
+private:
+    static constexpr int HISTORY = 16;    // Frames averaged
+    static constexpr int COOLDOWN = 8;    // Frames to wait after a change
+
+    double target_ms;
+    std::vector<Level> levels;
+    int level;
+    std::array<double, HISTORY> history = {};
+    int history_count = 0;
+    int history_next = 0;
+    int cooldown = 0;
+
+    // Select level, resets history since old frame times no longer apply
+    void select(int next);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef FRAME_WRITER_HPP
+#define FRAME_WRITER_HPP
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Renderer;
+
+// Writes resolved frames to disk on a background thread. Frames are copied into
+// a bounded ring of preallocated buffers, write() only blocks while every buffer
+// is still waiting for the disk. Each frame is encoded into one buffer and
+// written with a single call.
+class Frame_writer {
+public:
+    enum class Format {
+        Raw,  // Concatenated RGBA frames in one file
+        Ppm,  // One binary PPM per frame, # in the path is replaced by the frame number
+        Y4m   // YUV4MPEG2 stream, 4:4:4 BT.601 studio range
+    };
+
+    explicit Frame_writer(size_t ring_size = 4);
+    ~Frame_writer();
+
+    Frame_writer(const Frame_writer&) = delete;
+    Frame_writer& operator=(const Frame_writer&) = delete;
+
+    // Start writing frames of width x height, returns false if the output can't be opened
+    bool open(const std::string& path, Format format, int width, int height, int fps = 60);
+
+    // Queue a width * height ARGB frame, blocks while the ring is full. False after a write error.
+    bool write(const uint32_t* pixels);
+
+    // Queue the resolved framebuffer of renderer
+    bool write(const Renderer& renderer);
+
+    // Write queued frames and stop the writer thread, false if any write failed
+    bool close();
+
+    bool is_open() const { return open_; }
+
+    // Frames written to disk
+    uint64_t get_frames_written() const;
+
+    // Calls to write() that had to wait for a free buffer
+    uint64_t get_stalls() const;
+
+    // Format from file extension, .ppm and .y4m, anything else is raw
+    static Format format_from_path(const std::string& path);
+
+private:
+    struct Slot {
+        std::vector<uint32_t> pixels;
+        uint64_t frame;
+    };
+
+    std::vector<Slot> ring;
+    size_t head = 0;   // Next slot to fill
+    size_t tail = 0;   // Next slot to write
+    size_t queued = 0; // Filled slots
+
+    mutable std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    std::thread writer;
+    bool open_ = false;
+    bool closing = false;
+    bool failed = false;
+    uint64_t frames_submitted = 0;
+    uint64_t frames_written = 0;
+    uint64_t stalls = 0;
+
+    std::string path;
+    Format format = Format::Raw;
+    int width = 0, height = 0;
+    FILE* file = nullptr;          // Raw and Y4M output
+    std::vector<uint8_t> encoded;  // Encoded frame, writer thread only
+
+    // Thread body, encodes and writes slots until closed and drained
+    void writer_loop();
+
+    // Encode a frame into encoded
+    void encode(const Slot& slot);
+
+    // Write encoded to its file, false on error
+    bool flush_frame(uint64_t frame);
+
+    // Path of frame for PPM sequences
+    std::string frame_path(uint64_t frame) const;
+};
+
+#endif
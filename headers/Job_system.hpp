@@ -0,0 +1,67 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <cstddef>
+
+// Pool of worker threads running index ranges with work stealing. Jobs are dealt
+// round robin to per worker queues, a worker pops from the back of its own queue
+// and steals from the front of the others when it runs dry.
+class Job_system {
+public:
+    // Job called with job index and index of the worker running it
+    using Job = std::function<void(size_t index, unsigned worker)>;
+
+    // threads is the total worker count including the calling thread, 0 for all cores
+    explicit Job_system(unsigned threads = 0);
+    ~Job_system();
+
+    Job_system(const Job_system&) = delete;
+    Job_system& operator=(const Job_system&) = delete;
+
+    // Run job for every index in [0, count) and wait, the calling thread works as worker 0
+    void parallel_for(size_t count, const Job& job);
+
+    // Number of workers including the calling thread
+    unsigned get_worker_count() const { return worker_count; }
+
+private:
+    // Jobs in [head, jobs.size()), the vector keeps its capacity between runs
+    struct Queue {
+        std::mutex mutex;
+        std::vector<size_t> jobs;
+        size_t head = 0;
+    };
+
+    unsigned worker_count;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const Job* current = nullptr;     // Job of the running parallel_for
+    uint64_t generation = 0;          // Incremented for every parallel_for
+    std::atomic<size_t> remaining{0}; // Jobs not finished yet
+    unsigned active = 0;              // Workers draining the current job
+    bool stopping = false;
+
+    // Thread body of workers 1..n
+    void worker_loop(unsigned worker);
+
+    // Run jobs until every queue is empty
+    void drain(unsigned worker, const Job& job);
+
+    // Take job from own queue or steal one, false if all queues are empty
+    bool take(unsigned worker, size_t& index);
+};
+
+#endif
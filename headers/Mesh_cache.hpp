@@ -0,0 +1,65 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#pragma once
+
+#include "Render_math.hpp"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <stdint.h>
+
+// Immutable mesh data shared by every object built from the same parameters
+struct Mesh_data {
+    std::vector<Vec3> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Vec3> normals;
+    std::vector<Vec2> uvs;
+};
+
+// Procedural generators
+enum class Mesh_shape : uint32_t {
+    Cube, Sphere
+};
+
+// Generation parameters identifying a procedural mesh
+struct Mesh_key {
+    Mesh_shape shape;
+    float size = 0.0f;          // Shape specific size, radius of spheres
+    int segments[2] = {0, 0};   // Shape specific tessellation
+
+    bool operator<(const Mesh_key& rhs) const {
+        return std::tie(shape, size, segments[0], segments[1]) <
+               std::tie(rhs.shape, rhs.size, rhs.segments[0], rhs.segments[1]);
+    }
+};
+
+// Interns procedural meshes by their generation parameters. Objects keep a
+// shared handle to the immutable data, the cache only holds weak references so
+// a mesh is freed with its last object. Thread safe, generators run outside the
+// lock so they may use the cache themselves.
+class Mesh_cache {
+public:
+    using Handle = std::shared_ptr<const Mesh_data>;
+
+    // Returns mesh for key, generated on first use or after every holder released it
+    static Handle get(const Mesh_key& key, const std::function<Mesh_data()>& generate);
+
+    // Number of cached meshes still held by objects
+    static size_t get_live_count();
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::map<Mesh_key, std::weak_ptr<const Mesh_data>> meshes;
+        size_t sweep_size = 64;  // Entries at which released meshes are dropped
+    };
+
+    static State& state();
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef MESH_INSTANCE_HPP
+#define MESH_INSTANCE_HPP
+
+#pragma once
+
+#include "Render_math.hpp"
+#include "Renderable.hpp"
+#include "Quantized_mesh.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+// Renderable drawing mesh data owned elsewhere with its own model matrix
+class Mesh_instance : public Renderable {
+public:
+    Mesh_instance(const std::vector<Vec3>& vertices, const std::vector<uint32_t>& indices);
+
+    // Draw a quantized mesh owned elsewhere
+    explicit Mesh_instance(const Quantized_mesh& mesh);
+
+    // GETTERS
+    // Returns vector<Vec3> with vertices
+    const std::vector<Vec3>& get_vertices() const override;
+
+    // Returns vector<uint32_t> with indices
+    const std::vector<uint32_t>& get_indices() const override;
+
+    // Get Model matrix
+    const Mat4 get_model_matrix() const override;
+
+    // Returns vector<Vec3> with per vertex normals
+    const std::vector<Vec3>& get_normals() const override;
+
+    // Returns vector<uint32_t> with per vertex colors
+    const std::vector<uint32_t>& get_colors() const override;
+
+    // Returns vector<Vec2> with per vertex texture coordinates
+    const std::vector<Vec2>& get_uvs() const override;
+
+    // Returns ARGB fill color
+    uint32_t get_color() const override;
+
+    // Returns bounds of the referenced vertices, computed on construction and by update_bounds()
+    Aabb get_bounds() const override;
+
+    // Returns quantized mesh, null when drawing float vertices
+    const Quantized_mesh* get_quantized() const override;
+
+    // SETTERS
+    // Set model matrix
+    void set_model_matrix(const Mat4& _model);
+
+    // Set per vertex normals owned elsewhere
+    void set_normals(const std::vector<Vec3>& _normals);
+
+    // Set per vertex colors owned elsewhere
+    void set_colors(const std::vector<uint32_t>& _colors);
+
+    // Set per vertex texture coordinates owned elsewhere
+    void set_uvs(const std::vector<Vec2>& _uvs);
+
+    // Set ARGB fill color
+    void set_color(uint32_t _color);
+
+    // Recompute bounds after the referenced vertices were edited in place
+    void update_bounds();
+
+protected:
+    const std::vector<Vec3>* vertices;
+    const std::vector<uint32_t>* indices;
+    const Quantized_mesh* quantized = nullptr;
+    const std::vector<Vec3>* normals = &no_normals();
+    const std::vector<uint32_t>* colors = &no_colors();
+    const std::vector<Vec2>* uvs = &no_uvs();
+
+    Mat4 model = Mat4::identity();
+    uint32_t color = 0xFFFFFFFF;
+    Aabb bounds;
+
+};
+
+#endif
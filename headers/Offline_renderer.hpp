@@ -0,0 +1,42 @@
+#ifndef OFFLINE_RENDERER_HPP
+#define OFFLINE_RENDERER_HPP
+
+#pragma once
+
+#include "Renderer.hpp"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Renders independent frames concurrently, one frame per render context. Each
+// context is a headless Renderer with its own targets, mesh data referenced by
+// the scene is shared read only. Finished frames are emitted in frame order.
+class Offline_renderer {
+public:
+    // Set up and draw frame on renderer, context selects per context scene storage
+    using Setup = std::function<void(size_t frame, unsigned context, Renderer& renderer)>;
+
+    // Receive a resolved frame, called in frame order and never concurrently
+    using Emit = std::function<void(size_t frame, const Renderer& renderer)>;
+
+    // contexts is the number of frames in flight, 0 for all cores
+    Offline_renderer(int width, int height, unsigned contexts = 0);
+
+    Offline_renderer(const Offline_renderer&) = delete;
+    Offline_renderer& operator=(const Offline_renderer&) = delete;
+
+    // Render frames [0, count), the calling thread works as context 0
+    void render(size_t count, const Setup& setup, const Emit& emit);
+
+    // Number of render contexts
+    unsigned get_context_count() const { return unsigned(contexts.size()); }
+
+    // Render context for one time configuration such as reserving targets
+    Renderer& get_context(unsigned context) { return *contexts[context]; }
+
+private:
+    std::vector<std::unique_ptr<Renderer>> contexts;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef OVERDRAW_HPP
+#define OVERDRAW_HPP
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fill cost of one frame, counted per sample of the render target
+struct Overdraw_stats {
+    uint64_t fragments = 0;       // Fragments that reached the depth test
+    uint64_t passed = 0;          // Fragments that passed it and were written
+    uint64_t overwritten = 0;     // Written fragments covered by a later one
+    uint64_t covered = 0;         // Samples tested at least once
+    uint32_t max_complexity = 0;  // Most fragments tested on one sample
+
+    // Fragments per covered sample
+    double average_complexity() const { return covered ? double(fragments) / double(covered) : 0.0; }
+};
+
+// Per sample fragment counters behind the overdraw heatmap. Counting sites use
+// OVERDRAW_COUNT, which expands to nothing unless POLYRENDER_OVERDRAW is defined.
+class Overdraw {
+public:
+    bool is_enabled() const { return enabled; }
+    void set_enabled(bool enable) { enabled = enable; }
+
+    // Grow counters to hold at least samples entries
+    void reserve(size_t samples);
+
+    // Zero the counters of the first samples entries
+    void clear(size_t samples);
+
+    // Count a depth tested fragment of a sample
+    void add(int index, bool passed) {
+        tested[index]++;
+        written[index] += passed;
+    }
+
+    // Sum the counters of the first samples entries
+    Overdraw_stats summarize(size_t samples) const;
+
+    // Replace the first samples colors by the heatmap color of their depth complexity
+    void apply_heatmap(uint32_t* colors, size_t samples) const;
+
+    // Heatmap color of a depth complexity, black for none, then blue, cyan,
+    // green, yellow and red, white from 16 fragments up
+    static uint32_t heat_color(uint32_t complexity);
+
+private:
+    bool enabled = false;
+    std::vector<uint32_t> tested;   // Fragments depth tested per sample
+    std::vector<uint32_t> written;  // Fragments written per sample
+};
+
+#ifdef POLYRENDER_OVERDRAW
+#define OVERDRAW_COUNT(overdraw, index, passed) \
+    do { if ((overdraw).is_enabled()) (overdraw).add(index, passed); } while (0)
+#else
+#define OVERDRAW_COUNT(overdraw, index, passed) ((void)0)
+#endif
+
+#endif
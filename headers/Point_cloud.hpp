@@ -0,0 +1,56 @@
+#ifndef POINT_CLOUD_HPP
+#define POINT_CLOUD_HPP
+
+#pragma once
+
+#include "Render_math.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Colored points drawn by Renderer::render_points as depth tested square
+// splats, without triangle setup or clipping. Owns its points.
+class Point_cloud {
+public:
+    Point_cloud() = default;
+
+    // Points with per point ARGB colors, empty colors draws every point in get_color()
+    explicit Point_cloud(std::vector<Vec3> positions, std::vector<uint32_t> colors = {});
+
+    // GETTERS
+    const std::vector<Vec3>& get_positions() const { return positions; }
+    const std::vector<uint32_t>& get_colors() const { return colors; }
+    size_t get_point_count() const { return positions.size(); }
+
+    // Returns ARGB color of points without their own color
+    uint32_t get_color() const { return color; }
+
+    // Returns model matrix
+    const Mat4& get_model_matrix() const { return model; }
+
+    // Returns side of the square splat in window pixels
+    float get_point_size() const { return point_size; }
+
+    // Returns bounds of the points, computed once on construction
+    const Aabb& get_bounds() const { return bounds; }
+
+    // SETTERS
+    // Set ARGB color of points without their own color
+    void set_color(uint32_t _color);
+
+    // Set model matrix
+    void set_model_matrix(const Mat4& _model);
+
+    // Set side of the square splat in window pixels, at least 1
+    void set_point_size(float size);
+
+protected:
+    std::vector<Vec3> positions;
+    std::vector<uint32_t> colors;
+    uint32_t color = 0xFFFFFFFF;
+    Mat4 model = Mat4::identity();
+    float point_size = 1.0f;
+    Aabb bounds;
+};
+
+#endif
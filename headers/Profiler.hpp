@@ -0,0 +1,127 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Pipeline stages timed per frame
+enum class Stage {
+    Occlusion, Transform, Clip, Raster, Shade, Clear, Resolve, Present, Count
+};
+
+// Pipeline counters recorded per frame
+enum class Counter {
+    Triangles_submitted, // Triangles read from index buffers
+    Triangles_rejected,  // Triangles fully outside one clip plane
+    Triangles_clipped,   // Triangles crossing at least one clip plane
+    Triangles_degenerate,// Triangles culled for near zero area
+    Lines_drawn,         // Calls to draw_line
+    Pixels_drawn,        // Pixels written to the color buffer
+    Depth_pass,          // Depth tests passed in put_pixel
+    Depth_fail,          // Depth tests failed in put_pixel
+    Pixels_shaded,       // Samples shaded from the visibility buffer
+    Objects_occluded,    // Objects skipped by occlusion culling
+    Objects_outside,     // Objects skipped for bounds outside every view frustum
+    Pixels_damaged,      // Samples cleared and redrawn by a frame with dirty regions
+    Points_submitted,    // Points of point clouds entering the splat stage
+    Points_rejected,     // Points outside the view frustum
+    Count
+};
+
+// Statistics of a single frame
+struct Frame_stats {
+    uint64_t frame = 0;
+    double stage_ms[static_cast<int>(Stage::Count)] = {};
+    uint64_t counters[static_cast<int>(Counter::Count)] = {};
+
+    // Reset timings and counters, keeps frame number
+    void reset();
+
+    // Time of a stage in milliseconds
+    double get(Stage stage) const { return stage_ms[static_cast<int>(stage)]; }
+
+    // Value of a counter
+    uint64_t get(Counter counter) const { return counters[static_cast<int>(counter)]; }
+
+    // Sum of all stage timings
+    double total_ms() const;
+
+    // Name of stage and counter for printing
+    static const char* name(Stage stage);
+    static const char* name(Counter counter);
+};
+
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Profiler() = default;
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Add elapsed time to a stage
+    void add_time(Stage stage, Clock::duration elapsed) {
+        current.stage_ms[static_cast<int>(stage)] += std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+
+    // Increment counter
+    void add(Counter counter, uint64_t n = 1) {
+        current.counters[static_cast<int>(counter)] += n;
+    }
+
+    // Finish frame, stores it as last frame and streams it to CSV
+    void end_frame();
+
+    // Statistics of the last finished frame
+    const Frame_stats& last_frame() const { return last; }
+
+    // Statistics of the frame being recorded
+    const Frame_stats& current_frame() const { return current; }
+
+    // Stream every finished frame to a CSV file, returns false if the file can't be opened
+    bool open_csv(const std::string& path);
+
+    // Stop streaming to CSV
+    void close_csv();
+
+private:
+    Frame_stats current;
+    Frame_stats last;
+    FILE* csv = nullptr;
+};
+
+// Adds the time of its own lifetime to a stage
+class Profile_scope {
+public:
+    Profile_scope(Profiler& profiler, Stage stage) :
+        profiler(profiler), stage(stage), start(Profiler::Clock::now()) {}
+
+    ~Profile_scope() {
+        profiler.add_time(stage, Profiler::Clock::now() - start);
+    }
+
+private:
+    Profiler& profiler;
+    Stage stage;
+    Profiler::Clock::time_point start;
+};
+
+// Instrumentation macros, expand to nothing unless POLYRENDER_PROFILE is defined
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef POLYRENDER_PROFILE
+#define PROFILE_SCOPE(profiler, stage) Profile_scope PROFILE_CONCAT(profile_scope_, __LINE__)(profiler, stage)
+#define PROFILE_COUNT(profiler, counter, n) (profiler).add(counter, n)
+#else
+#define PROFILE_SCOPE(profiler, stage) ((void)0)
+#define PROFILE_COUNT(profiler, counter, n) ((void)0)
+#endif
+
+#endif
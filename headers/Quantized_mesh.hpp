@@ -0,0 +1,87 @@
+#ifndef QUANTIZED_MESH_HPP
+#define QUANTIZED_MESH_HPP
+
+#pragma once
+
+#include "Render_math.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+// Compressed mesh positions and indices. Positions are stored as 16 bit steps
+// of the mesh bounding box, half the size of Vec3. Triangles are split in
+// order into clusters referencing at most 65536 consecutive vertices, whose
+// indices are 16 bit offsets from the cluster base vertex, so large meshes
+// keep 16 bit indices too. Positions keep their order and per vertex data of
+// the source mesh still applies. get_dequantize() maps packed positions back
+// to model space, the renderer folds it into the model matrix so packed
+// positions are transformed directly.
+class Quantized_mesh {
+public:
+    // Consecutive triangles sharing a base vertex
+    struct Cluster {
+        uint32_t first_index;  // Position of the first index in the mesh
+        uint32_t index_count;
+        uint32_t base_vertex;  // Added to the local indices
+        uint32_t offset;       // Of the local indices in get_indices16() or get_indices32()
+        bool wide;             // Local indices are 32 bit, for triangles spanning more than 65536 vertices
+    };
+
+    Quantized_mesh(const std::vector<Vec3>& vertices, const std::vector<uint32_t>& indices);
+
+    // GETTERS
+    // Returns packed positions
+    const std::vector<Vec3_u16>& get_positions() const { return positions; }
+
+    // Returns matrix mapping packed positions to model space
+    const Mat4& get_dequantize() const { return dequantize; }
+
+    // Returns model space bounds of the source vertices
+    const Aabb& get_bounds() const { return bounds; }
+
+    size_t get_vertex_count() const { return positions.size(); }
+    size_t get_index_count() const { return index_count; }
+
+    // Returns clusters in index order
+    const std::vector<Cluster>& get_clusters() const { return clusters; }
+
+    // Returns cluster holding index i
+    const Cluster& find_cluster(size_t i) const;
+
+    // Returns local indices of the 16 bit clusters
+    const uint16_t* get_indices16() const { return indices16.data(); }
+
+    // Returns local indices of the wide clusters
+    const uint32_t* get_indices32() const { return indices32.data(); }
+
+    // Returns the vertices of the triangle starting at index i of a cluster
+    void get_triangle(const Cluster& cluster, size_t i, uint32_t& a, uint32_t& b, uint32_t& c) const {
+        size_t local = cluster.offset + (i - cluster.first_index);
+        if (cluster.wide) {
+            a = indices32[local]; b = indices32[local + 1]; c = indices32[local + 2];
+            return;
+        }
+        uint32_t base = cluster.base_vertex;
+        a = base + indices16[local]; b = base + indices16[local + 1]; c = base + indices16[local + 2];
+    }
+
+    // Returns index i
+    uint32_t get_index(size_t i) const;
+
+    // Returns dequantized model space position of vertex i
+    Vec3 get_position(size_t i) const;
+
+    // Returns bytes used by positions and indices
+    size_t get_memory() const;
+
+private:
+    std::vector<Vec3_u16> positions;
+    std::vector<uint16_t> indices16;
+    std::vector<uint32_t> indices32;
+    std::vector<Cluster> clusters;
+    size_t index_count = 0;
+    Mat4 dequantize = Mat4::identity();
+    Aabb bounds;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 
 // 2D Vector
@@ -134,6 +135,11 @@ struct Vec4 {
 
 };
 
+// 3D position quantized to 16 bit steps of a bounding box, see Quantized_mesh
+struct Vec3_u16 {
+    uint16_t x, y, z;
+};
+
 // 3x3 Matrix
 struct Mat3 {
     float m[3][3];
@@ -315,6 +321,43 @@ struct Mat4 {
 
     }
 
+    // Transform quantized position as a point, the dequantization belongs in the matrix
+    Vec4 transform(const Vec3_u16& v) const {
+        float x = v.x, y = v.y, z = v.z;
+        return Vec4(
+            m[0][0]*x + m[0][1]*y + m[0][2]*z + m[0][3],
+            m[1][0]*x + m[1][1]*y + m[1][2]*z + m[1][3],
+            m[2][0]*x + m[2][1]*y + m[2][2]*z + m[2][3],
+            m[3][0]*x + m[3][1]*y + m[3][2]*z + m[3][3]
+        );
+
+    }
+
+    // Transform direction Vec3, ignores translation
+    Vec3 transform_dir(const Vec3& v) const {
+        return Vec3(
+            m[0][0]*v.x + m[0][1]*v.y + m[0][2]*v.z,
+            m[1][0]*v.x + m[1][1]*v.y + m[1][2]*v.z,
+            m[2][0]*v.x + m[2][1]*v.y + m[2][2]*v.z
+        );
+
+    }
+
+    // Normal matrix, cofactor of the upper 3x3 so normals stay perpendicular under non uniform scale
+    Mat4 normal_matrix() const {
+        Mat4 mat = identity();
+        mat.m[0][0] = m[1][1]*m[2][2] - m[1][2]*m[2][1];
+        mat.m[0][1] = m[1][2]*m[2][0] - m[1][0]*m[2][2];
+        mat.m[0][2] = m[1][0]*m[2][1] - m[1][1]*m[2][0];
+        mat.m[1][0] = m[0][2]*m[2][1] - m[0][1]*m[2][2];
+        mat.m[1][1] = m[0][0]*m[2][2] - m[0][2]*m[2][0];
+        mat.m[1][2] = m[0][1]*m[2][0] - m[0][0]*m[2][1];
+        mat.m[2][0] = m[0][1]*m[1][2] - m[0][2]*m[1][1];
+        mat.m[2][1] = m[0][2]*m[1][0] - m[0][0]*m[1][2];
+        mat.m[2][2] = m[0][0]*m[1][1] - m[0][1]*m[1][0];
+        return mat;
+    }
+
     // Multiply 4x4 matrix
     Mat4 operator*(const Mat4& rhs) const {
         Mat4 result;
@@ -333,4 +376,29 @@ struct Mat4 {
 
 };
 
+// Axis aligned bounding box
+struct Aabb {
+    Vec3 min, max;
+
+    Aabb() : min(INFINITY, INFINITY, INFINITY), max(-INFINITY, -INFINITY, -INFINITY) {}
+    Aabb(const Vec3& min, const Vec3& max) : min(min), max(max) {}
+
+    // Grow box to contain point
+    void expand(const Vec3& p) {
+        min = Vec3(std::fmin(min.x, p.x), std::fmin(min.y, p.y), std::fmin(min.z, p.z));
+        max = Vec3(std::fmax(max.x, p.x), std::fmax(max.y, p.y), std::fmax(max.z, p.z));
+    }
+
+    // True if no point was added
+    bool empty() const {
+        return min.x > max.x;
+    }
+
+    // Corner i of the box, bit 0 selects x, bit 1 y and bit 2 z of max
+    Vec3 corner(int i) const {
+        return Vec3(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+    }
+
+};
+
 #endif
\ No newline at end of file
@@ -8,6 +8,9 @@
 #include <vector>
 #include <stdint.h>
 
+class Quantized_mesh;
+class Texture;
+
 class Renderable {
 public:
     virtual ~Renderable() = default;
@@ -21,6 +24,53 @@ public:
     // Returns model matrix containing rotation, position and scale
     virtual const Mat4 get_model_matrix() const = 0;
 
+    // Returns vector<Vec3> with per vertex normals, empty if the mesh has none
+    virtual const std::vector<Vec3>& get_normals() const { return no_normals(); }
+
+    // Returns vector<uint32_t> with per vertex ARGB colors, empty if the mesh has none
+    virtual const std::vector<uint32_t>& get_colors() const { return no_colors(); }
+
+    // Returns vector<Vec2> with per vertex texture coordinates, empty if the mesh has none
+    virtual const std::vector<Vec2>& get_uvs() const { return no_uvs(); }
+
+    // Returns ARGB color used when the mesh has no vertex colors
+    virtual uint32_t get_color() const { return 0xFFFFFFFF; }
+
+    // Returns model space bounding box. Culling calls it several times per frame,
+    // meshes keep it up to date rather than walking their vertices on each call.
+    virtual Aabb get_bounds() const = 0;
+
+    // Returns packed positions and indices, null for meshes stored as floats.
+    // get_vertices() and get_indices() are empty when this is set.
+    virtual const Quantized_mesh* get_quantized() const { return nullptr; }
+
+    // Occluders are drawn into the occlusion buffer before other objects are tested against it
+    bool is_occluder() const { return occluder; }
+    void set_occluder(bool _occluder) { occluder = _occluder; }
+
+    // Texture modulating filled rendering, owned elsewhere. Used when the mesh has texture coordinates.
+    const Texture* get_texture() const { return texture; }
+    void set_texture(const Texture* _texture) { texture = _texture; }
+
+protected:
+    bool occluder = false;
+    const Texture* texture = nullptr;
+
+    static const std::vector<Vec3>& no_normals() {
+        static const std::vector<Vec3> empty;
+        return empty;
+    }
+
+    static const std::vector<uint32_t>& no_colors() {
+        static const std::vector<uint32_t> empty;
+        return empty;
+    }
+
+    static const std::vector<Vec2>& no_uvs() {
+        static const std::vector<Vec2> empty;
+        return empty;
+    }
+
 };
 
 #endif
\ No newline at end of file
@@ -5,19 +5,33 @@
 
 #include "Render_math.hpp"
 #include "Renderable.hpp"
+#include "Profiler.hpp"
+#include "Job_system.hpp"
+#include "Overdraw.hpp"
 
 #include <vector>
 #include <array>
+#include <atomic>
 #include <iostream> // FOR DEBUG REMOVE LATER
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <cstring>
+#include <string>
+#include <memory>
 #include <cmath>
 #include <cstdint>
 #include <algorithm>
 
+class Point_cloud;
+class Texture;
+
 class Renderer {
 public:
     Renderer(int width, int height);
+    ~Renderer();
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
 
     // Inits display window
     void init_x11();
@@ -28,6 +42,12 @@ public:
     // Disable SSAA
     void disable_ssaa();
 
+    // Scale internal render resolution relative to the window, clamped to [0.25, 1]
+    void set_render_scale(float scale);
+
+    // Preallocate sample buffers up to an SSAA factor so later changes never reallocate
+    void reserve_render_target(int max_factor);
+
     // METHODS
 
     // Project vertex from model space to screen space
@@ -35,16 +55,24 @@ public:
 
     // Render wireframe
     void render_wireframe(const Renderable& obj);
+    void render_wireframe(const Renderable& obj, const Mat4& model);
 
     // Render multiple wireframes
     void render_wireframes();
 
     // Render filled object
     void render_filled(const Renderable& obj);
+    void render_filled(const Renderable& obj, const Mat4& model);
+
+    // Render all objects in the current render mode
+    void render();
 
     // Draw line on screen
     void draw_line(Vec3 v0, Vec3 v1, uint32_t color);
 
+    // Draw line with Wu style coverage blended over the target, depth tested
+    void draw_line_aa(Vec3 v0, Vec3 v1, uint32_t color);
+
     // Set color of pixel
     void put_pixel(int x, int y, float z, uint32_t color); // For drendering with respect to depth
     void put_pixel(int x, int y, uint32_t color); // Does not respect depth
@@ -58,20 +86,44 @@ public:
     // Sends framebuffer to display
     void show();
 
+    // Resolves SSAA buffer into framebuffer, done by show()
+    void resolve();
+
     // Add object to the scene
     void add_object(Renderable* obj);
 
+    // Remove all objects from the scene
+    void clear_objects();
+
     // Clamps screen coordinates
     inline int clamp(int value, int min, int max);
+    inline float clamp(float value, float min, float max);
 
     // Transform model to clip
     Vec4 model_to_clip(const Vec3& vertex, const Mat4& model_matrix) const;
 
     // Helper to compute baryentric coordinates
-    inline bool Renderer::barycentric(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c, float& u, float& v, float& w);
+    inline bool barycentric(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c, float& u, float& v, float& w);
 
     // Rasterize a single triangle
-    void Renderer::draw_triangle(const Vec3& v0, const Vec3& v1, const Vec3& v2, uint32_t color);
+    void draw_triangle(const Vec3& v0, const Vec3& v1, const Vec3& v2, uint32_t color);
+
+    // Screen space vertex for rasterization
+    struct Raster_vertex {
+        float x, y, z;   // Screen position and depth in [0, 1]
+        float inv_w;     // 1 / clip w, for perspective correct interpolation
+        float r, g, b;   // Color channels 0-255
+        float u, v;      // Texture coordinates
+    };
+
+    // Rasterize a single triangle with perspective correct color interpolation.
+    // With a texture its level is sampled at the perspective correct texture
+    // coordinates and modulated by the color.
+    void draw_triangle(const Raster_vertex& v0, const Raster_vertex& v1, const Raster_vertex& v2,
+                       const Texture* texture = nullptr, int level = 0);
+
+    // Rasterize a single triangle into the visibility buffer, writes only depth and id
+    void draw_triangle_id(const Raster_vertex& v0, const Raster_vertex& v1, const Raster_vertex& v2, uint32_t id);
 
     // SETTERS
     
@@ -81,6 +133,128 @@ public:
     // Set projection fov nearZ and farZ
     void set_projection(float fov, float nearZ, float farZ);
 
+    // Set camera matrix directly
+    void set_view_matrix(const Mat4& _view);
+
+    // Set projection matrix directly
+    void set_projection_matrix(const Mat4& _projection);
+
+    // Camera and window area of one view
+    struct View {
+        Mat4 view;
+        Mat4 projection;
+        int x, y, width, height; // Viewport in window pixels
+    };
+
+    // Render every view in one pass, for split screen or stereo. Lighting and
+    // per object setup run once, transform, clipping and rasterization per view
+    // into its viewport. Empty draws the single camera over the whole window.
+    // The visibility buffer and occlusion culling only apply to single view rendering.
+    void set_views(const std::vector<View>& _views);
+
+    // RENDER MODES
+    enum class Render_mode {
+        Wireframe, Filled
+    };
+
+    enum class Shade_mode {
+        Flat,    // One lit color per triangle from its face normal
+        Gouraud  // Lit per vertex from vertex normals, interpolated across the triangle
+    };
+
+    // Object with the model matrix and modes it is drawn with
+    struct Draw_item {
+        const Renderable* obj;
+        Mat4 model;
+        Render_mode mode;
+        Shade_mode shade;
+    };
+
+    // Render a batch of objects in order through the chunked geometry stage
+    void render_batch(const std::vector<Draw_item>& items);
+
+    // Draw a point cloud as depth tested splats into the color and depth samples
+    // meshes use, so both composite. Chunks of points are transformed, tested
+    // against the frustum and splatted on the job system. The nearest point wins
+    // each sample, ties the lower color, so the image doesn't depend on threads.
+    void render_points(const Point_cloud& cloud);
+
+    // Run the geometry stage on a job system, null runs it on the calling thread
+    void set_job_system(Job_system* jobs);
+
+    // Set mode used by render()
+    void set_render_mode(Render_mode mode);
+
+    // Set shading of filled objects
+    void set_shade_mode(Shade_mode mode);
+
+    // Set world space direction light travels in and ambient light [0, 1]
+    void set_light(const Vec3& direction, float _ambient);
+
+    // Rasterize filled objects to depth and triangle ids first and shade each
+    // visible sample once in resolve(). Objects must stay unchanged until then.
+    void enable_visibility_buffer(bool enable);
+
+    // Draw lines antialiased, a cheaper alternative to SSAA for wireframes
+    void enable_aa_lines(bool enable);
+
+    // Skip objects whose bounds are hidden behind occluders, see Renderable::set_occluder.
+    // Occluders count as solid, also in wireframe mode.
+    void enable_occlusion_culling(bool enable);
+
+    // Store color, depth and id samples in 8x8 tiles, Morton ordered inside each
+    // tile, so spans on neighbouring rows share cache lines. The framebuffer stays
+    // linear, samples are detiled in resolve(). Samples are undefined until the next clear.
+    void enable_tiled_layout(bool enable);
+
+    // Let render() redraw only what changed since the last frame. The screen bounds
+    // of each object in the last and the current frame mark damaged rectangles, only
+    // those are cleared, drawn from the objects overlapping them, resolved and
+    // presented. Applies to frames drawn with clear(), one render() and show(), other
+    // draws or a camera, light or target change redraw the whole frame. Falls back to
+    // full frames with the visibility buffer, occlusion culling or set_views().
+    void enable_dirty_regions(bool enable);
+
+    // Redraw the whole next frame, needed after editing a mesh, its vertex colors or a texture in place
+    void invalidate();
+
+    // GETTERS
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+
+    // Returns SSAA factor, 1 when SSAA is disabled
+    int get_ssaa_factor() const { return ssaa_factor; }
+
+    // Returns internal render resolution scale
+    float get_render_scale() const { return render_scale; }
+
+    const Mat4& get_view_matrix() const { return view; }
+    const Mat4& get_projection_matrix() const { return projection; }
+
+    // Returns objects in the scene
+    const std::vector<Renderable*>& get_objects() const { return objects; }
+
+    Render_mode get_render_mode() const { return render_mode; }
+    Shade_mode get_shade_mode() const { return shade_mode; }
+    bool get_visibility_buffer() const { return visibility; }
+    bool get_occlusion_culling() const { return occlusion; }
+    bool get_aa_lines() const { return aa_lines; }
+    bool get_tiled_layout() const { return tiled; }
+    bool get_dirty_regions() const { return dirty_regions; }
+    const std::vector<View>& get_views() const { return views; }
+    const Vec3& get_light_dir() const { return light_dir; }
+    float get_ambient() const { return ambient; }
+
+    // Returns color used by the last clear
+    uint32_t get_clear_color() const { return clear_color; }
+
+    // Returns resolved framebuffer, width * height ARGB pixels
+    const uint32_t* get_framebuffer() const { return framebuffer; }
+
+    // FNV-1a hash of the resolved framebuffer
+    uint64_t framebuffer_checksum() const;
+
     // CLIP PLANE
     enum class Clip_plane {
         Left, Right, Bottom, Top, Near, Far
@@ -93,33 +267,306 @@ public:
     // Interpolate clipping
     static Vec4 interpolate(const Vec4& a, const Vec4& b, Clip_plane plane);
 
+    // Position of the clip plane crossing along a to b, in [0, 1]
+    static float intersect(const Vec4& a, const Vec4& b, Clip_plane plane);
+
+    // Clip space vertex with weights of the vertices of the unclipped triangle
+    struct Clip_vertex {
+        Vec4 pos;
+        Vec3 weights;
+    };
+
     // Clip polygon against a single plane
-    std::vector<Vec4> clip_poly(const std::vector<Vec4>& vertices, Renderer::Clip_plane plane);
+    static std::vector<Clip_vertex> clip_poly(const std::vector<Clip_vertex>& vertices, Renderer::Clip_plane plane);
 
     // Clip triangles
     std::vector<std::array<Vec4, 3>> clip_triangle(const std::array<Vec4, 3>& triangle);
 
+    // Clip triangles, keeps vertex weights for attribute interpolation
+    std::vector<std::array<Clip_vertex, 3>> clip_triangle_weighted(const std::array<Vec4, 3>& triangle);
+
+    // Bit mask of clip planes a vertex is outside of
+    static int outcode(const Vec4& v);
+
+    // PROFILING
+
+    // Statistics of the last presented frame, zero if profiling is compiled out
+    const Frame_stats& get_stats() const;
+
+    // Stream per frame statistics to a CSV file, false if profiling is compiled out
+    bool open_stats_csv(const std::string& path);
+
+    // Stop streaming statistics
+    void close_stats_csv();
+
+    // Show depth complexity instead of colors. Every fragment reaching a depth test
+    // is counted per sample, resolve() turns the counts into a heatmap and sums
+    // them into get_overdraw_stats(). False if overdraw counting is compiled out.
+    bool enable_overdraw(bool enable);
+
+    // Fill cost of the last resolved frame, zero unless overdraw is enabled
+    const Overdraw_stats& get_overdraw_stats() const { return overdraw_stats; }
+
 protected:
     int width, height;     // Window size
     int size;              // Size of framebuffer
-    Display* display;      // Display
+    Display* display = nullptr; // Display, null when rendering headless
     Window window;         // Window
     GC gc;                 // gc
-    XImage* ximage;        // Image
+    XImage* ximage = nullptr;   // Image
     uint32_t* framebuffer; // Framebuffer
+    uint32_t clear_color = 0;   // Color of the last clear
+
+    // Shading
+    Render_mode render_mode = Render_mode::Wireframe;
+    Shade_mode shade_mode = Shade_mode::Gouraud;
+    Vec3 light_dir = Vec3(-0.3f, -0.5f, -1.0f).norm(); // Direction light travels
+    float ambient = 0.2f;  // Light reaching surfaces facing away
+    bool aa_lines = false; // draw_line uses draw_line_aa
+
+    // Blend color into a pixel by coverage in [0, 1] if it passes the depth test,
+    // depth is written only where the line covers most of the pixel
+    void blend_pixel(int x, int y, float z, uint32_t color, float coverage);
+
+    // Vertex stage output of the current batch, reused between batches
+    std::vector<Vec4> clip_verts;     // Clip space positions
+    std::vector<int> clip_codes;      // Outcodes of the batch vertices
+    std::vector<Vec3> vert_colors;    // Lit vertex colors 0-255
+
+    // Geometry stage, objects are split into chunks processed by the job system
+    static constexpr size_t VERTEX_CHUNK = 1024;
+    static constexpr size_t TRIANGLE_CHUNK = 256;
+
+    struct Batch_object {
+        const Draw_item* item;
+        Mat4 mvp;
+        Mat4 normal_matrix;
+        bool gouraud;
+        const Texture* texture;  // Null unless filled with a texture and texture coordinates
+        size_t vertex_offset;    // Offset of the first vertex in the batch arrays
+        uint32_t base_id;        // Visibility id of the first triangle
+        bool culled;             // Hidden behind occluders or outside every view
+        bool outside;            // Outside the view being drawn
+    };
+    struct Vertex_chunk {
+        size_t object;
+        size_t begin, end;
+    };
+    struct Triangle_chunk {
+        size_t object;
+        size_t begin, end;
+    };
+    struct Screen_triangle {
+        Raster_vertex v[3];
+        uint32_t id;             // Visibility id
+        uint32_t item;           // Index of the draw item
+        int level;               // Mip level of a textured item
+    };
+    struct Chunk_counts {
+        uint64_t submitted = 0, rejected = 0, clipped = 0, degenerate = 0;
+    };
+
+    Job_system* jobs = nullptr;  // Not owned
+
+    std::vector<Draw_item> single_item;   // Batch of render_filled and render_wireframe
+    std::vector<Draw_item> scene_items;   // Batch of render and render_wireframes
+    std::vector<Batch_object> batch_objects;
+    std::vector<Vertex_chunk> vertex_chunks;
+    std::vector<Triangle_chunk> triangle_chunks;
+    std::vector<std::vector<Screen_triangle>> chunk_outputs; // Triangles of each chunk in a wave
+    std::vector<Chunk_counts> chunk_counts;
+    Vec4* batch_clip = nullptr;   // Clip space vertices of the batch
+    Vec3* batch_colors = nullptr; // Vertex colors of the batch
+    bool batch_visibility = false; // Batch renders into the visibility buffer
+
+    // Pixel rectangle [x0, x1) x [y0, y1) of the render target
+    struct Rect {
+        int x0, y0, x1, y1;
+    };
+
+    // Views of multi view rendering, empty for the single camera
+    std::vector<View> views;
+    Rect viewport = {0, 0, 0, 0}; // Target area of the view being drawn, raster output stays inside
+    Rect scissor = {0, 0, 0, 0};  // Part of the viewport being written, one damaged rect with dirty regions
+
+    // Dirty regions, what render() drew in the last frame
+    struct Scene_state {
+        const Renderable* obj;
+        Mat4 model;
+        Render_mode mode;
+        Shade_mode shade;
+        uint32_t color;
+        const Texture* texture;
+        const void* mesh;        // Vertex storage, a different mesh damages like a move
+        size_t vertex_count;
+        Rect bounds;             // Target samples the object can touch, empty if culled
+    };
+    static constexpr size_t MAX_DAMAGE_RECTS = 16; // More are merged into their bounding rect
+    bool dirty_regions = false;
+    bool scene_valid = false;     // last_scene describes the contents of the target
+    bool scene_batch = false;     // render_batch is drawing the scene of render()
+    bool clear_pending = false;   // clear() was deferred to render(), which knows the damage
+    bool partial = false;         // This frame redraws, resolves and presents only damage
+    int frame_batches = 0;        // Batches drawn since the last clear
+    Mat4 last_view_projection;
+    std::vector<Scene_state> last_scene, next_scene;
+    std::vector<Rect> damage;     // Disjoint damaged rects of the render target
+    std::vector<Rect> present_rects; // Window pixels reading damaged samples
+
+    // Target samples the projected bounds can touch, the whole target if they cross the eye plane
+    Rect screen_bounds(const Aabb& bounds, const Mat4& mvp) const;
+
+    // Compare the scene with the last frame and clear the damaged rects if the
+    // frame can be drawn partially, otherwise partial stays false
+    void update_damage(const std::vector<Draw_item>& items);
+
+    // Add a rect to damage, merging it with the rects it overlaps
+    void add_damage(Rect rect);
+
+    // Window pixels whose resolve reads samples of a target rect
+    Rect window_rect(const Rect& target) const;
+
+    // Fill color and depth samples of the whole target
+    void clear_target();
+
+    // Viewport of a view scaled from window pixels to the render target
+    Rect target_viewport(const View& view) const;
+
+    // True if bounds lie outside one clip plane of mvp
+    static bool outside_frustum(const Aabb& bounds, const Mat4& mvp);
+
+    // Run count jobs on the job system or inline
+    void run_jobs(size_t count, const Job_system::Job& job);
+
+    // Flush a clear deferred by dirty regions and count the batch, draws
+    // other than the scene of render() make the next frame a full one
+    void begin_batch();
+
+    // Point splatting, chunks min depth and color packed into one key per sample
+    // with atomics, the keys are merged into the target after every chunk ran
+    static constexpr size_t POINT_CHUNK = 16384;
+    static constexpr uint64_t NO_POINT = ~uint64_t(0);
+    struct Point_chunk {
+        Rect touched;            // Samples written, empty if none
+        uint64_t submitted, rejected;
+    };
+    std::unique_ptr<std::atomic<uint64_t>[]> point_keys; // Depth bits high, color low, NO_POINT when empty
+    size_t point_capacity = 0;
+    std::vector<Point_chunk> point_chunks;
+
+    // Transform, frustum test and splat points [begin, end) of cloud into point_keys
+    void splat_points(const Point_cloud& cloud, const Mat4& mvp, int splat, size_t begin, size_t end,
+                      Point_chunk& chunk) const;
+
+    // Depth test the keys of rect against the target and reset them
+    void merge_points(const Rect& rect);
+
+    // Transform and outcode a range of vertices of one object for the current
+    // view, light them if colors is set
+    void process_vertices(const Vertex_chunk& chunk, bool positions, bool colors);
+
+    // Cull, clip and map a range of triangles of one object to screen space
+    void process_triangles(const Triangle_chunk& chunk, std::vector<Screen_triangle>& out,
+                           Chunk_counts& counts) const;
+
+    // A triangle clipped by 6 planes has at most 9 vertices in exact arithmetic,
+    // polygons rounding pushes past it are dropped
+    static constexpr size_t MAX_CLIP_VERTICES = 9;
+
+    // Clip triangle against all planes using 2 * MAX_CLIP_VERTICES scratch vertices,
+    // returns the polygon and its vertex count
+    static const Clip_vertex* clip_planes(const std::array<Vec4, 3>& triangle, Clip_vertex* scratch, size_t& count);
+
+    // Clip polygon against a single plane into out, which holds capacity vertices,
+    // returns 0 if the result does not fit
+    static size_t clip_poly(const Clip_vertex* vertices, size_t count, Clip_vertex* out, size_t capacity,
+                            Clip_plane plane);
+
+    // Visibility buffer, ids are per frame triangle numbers starting at 1
+    struct Vis_object {
+        const Renderable* obj;
+        uint32_t base_id;        // Id of the first triangle
+        size_t vertex_offset;    // Offset into vis_clip_verts and vis_colors
+        Mat4 normal_matrix;
+        bool gouraud;
+        const Texture* texture;  // Null if untextured
+    };
+    bool visibility = false;
+    std::vector<uint32_t> id_buffer;       // Triangle id per sample, 0 is empty
+    std::vector<Vis_object> vis_objects;   // Filled objects drawn this frame
+    std::vector<Vec4> vis_clip_verts;      // Clip space vertices of all objects
+    std::vector<Vec3> vis_colors;          // Vertex colors of all objects
+    uint32_t vis_next_id = 1;
+
+    // Shade each visible sample of the visibility buffer
+    void shade_visibility();
+
+    // Occlusion culling, occluders are rasterized into a small depth buffer in
+    // normalized device coordinates that object bounds are tested against
+    static constexpr int OCCLUSION_WIDTH = 256;
+    static constexpr int OCCLUSION_HEIGHT = 128;
+    bool occlusion = false;
+    std::vector<float> occlusion_depth;  // Nearest occluder depth per pixel
+    std::vector<Vec4> occluder_verts;    // Clip space vertices of the current occluder
+
+    // Rasterize pixels fully covered by the occluder with their farthest depth
+    void rasterize_occluder(const Renderable& obj, const Mat4& mvp);
+
+    // True if the projected bounds lie behind the occlusion buffer everywhere
+    bool occluded(const Aabb& bounds, const Mat4& mvp) const;
     Mat4 view;             // Camera matrix
     Mat4 projection;       // Projection to screen matrix
     std::vector<Renderable*> objects; // Objects to render in scene
     std::vector<float> zbuffer;       // Z-Buffer for depth perspective
 
-    // SSAA
-    bool ssaa = false;     // Enable SSAA
-    int ssaa_factor;       // SSAA factor
+    // SSAA and scaled rendering, both render into the SSAA buffer
+    bool ssaa = false;     // Render into SSAA buffer instead of framebuffer
+    int ssaa_factor = 1;   // SSAA factor
+    float render_scale = 1.0f;  // Render resolution relative to window
     int ssaa_width;        // Width of SSAA buffer
     int ssaa_height;       // Height of SSAA buffer
     int ssaa_size;         // Size of SSAA buffer
     int ssaa_samples;      // Sample size of SSAA
-    uint32_t* ssaa_buffer; // SSAA framebuffer
+    int ssaa_capacity = 0; // Allocated size of SSAA buffer
+    uint32_t* ssaa_buffer = nullptr; // SSAA framebuffer
+
+    // Sample layout of the render target, sample x, y is at row_offset[y] + col_offset[x]
+    static constexpr int TILE_SIZE = 8;
+    bool tiled = false;    // Tiled layout, always renders into the SSAA buffer
+    std::vector<int> row_offset, col_offset;
+    int sample_index(int x, int y) const { return row_offset[y] + col_offset[x]; }
+
+    // Build offset tables of a target_width x target_height target, returns samples it spans
+    int update_layout(int target_width, int target_height);
+
+    // Source sample columns and rows for each window pixel when resolving a scaled buffer
+    std::vector<int> resolve_x0, resolve_x1, resolve_wx;
+    std::vector<int> resolve_y0, resolve_y1, resolve_wy;
+
+    // Resize render target after SSAA factor or render scale changed
+    void update_render_target();
+
+    // Grow sample buffers to hold at least samples entries
+    void reserve_samples(int samples);
+
+    // Grow depth and visibility buffers to hold at least samples entries
+    void reserve_depth(int samples);
+
+    // Resolve window pixels of area from the SSAA buffer
+    void resolve_area(const Rect& area);
+
+    // Resolve paths for the SSAA buffer
+    void resolve_detile(const Rect& area);
+    void resolve_box_integer(const Rect& area);
+    void resolve_box(const Rect& area);
+    void resolve_bilinear(const Rect& area);
+
+#ifdef POLYRENDER_PROFILE
+    Profiler profiler;     // Per frame stage timings and counters
+#endif
+
+    Overdraw overdraw;     // Fragment counts per sample, only counted with POLYRENDER_OVERDRAW
+    Overdraw_stats overdraw_stats;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef SCENE_GRAPH_HPP
+#define SCENE_GRAPH_HPP
+
+#pragma once
+
+#include "Render_math.hpp"
+#include "Renderable.hpp"
+#include "Command_buffer.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Transform hierarchy stored as flat arrays in depth first order, so every
+// subtree is one contiguous range. Changing a local transform marks its node
+// dirty and update() recomputes only the dirty subtrees, each in one linear
+// pass where parents always come before their children. Nodes are appended,
+// adding to a parent whose subtree isn't last defers restoring the order to
+// one linear pass in the next update().
+class Scene_graph {
+public:
+    // Stable handle of a node, array positions move when nodes are inserted
+    using Node = uint32_t;
+    static constexpr Node NONE = UINT32_MAX;
+
+    // Add node as last child of parent, NONE adds a root
+    Node add_node(Node parent = NONE, const Mat4& local = Mat4::identity());
+
+    // Remove all nodes
+    void clear();
+
+    // Set local transform relative to the parent, marks the subtree dirty
+    void set_local(Node node, const Mat4& local);
+
+    // Attach mesh drawn with the world matrix of node, null detaches it
+    void set_mesh(Node node, const Renderable* mesh, Draw_state state = Draw_state());
+
+    // Recompute world matrices of dirty subtrees
+    void update();
+
+    // Record draws of every node with a mesh in depth first order, call update() first
+    void record(Command_list& list) const;
+
+    // GETTERS
+    const Mat4& get_local(Node node) const { return local[index_of[node]]; }
+    const Mat4& get_world(Node node) const { return world[index_of[node]]; }
+    Node get_parent(Node node) const;
+    size_t get_node_count() const { return parent.size(); }
+
+    // Nodes recomputed by the last update()
+    size_t get_updated_count() const { return updated; }
+
+private:
+    // Per position arrays in depth first order
+    std::vector<uint32_t> parent;        // Position of the parent, NONE for roots
+    std::vector<uint32_t> subtree_end;   // Position past the last descendant
+    std::vector<Mat4> local;
+    std::vector<Mat4> world;
+    std::vector<const Renderable*> mesh;
+    std::vector<Draw_state> state;
+    std::vector<Node> node_at;           // Handle of each position
+
+    std::vector<uint32_t> index_of;      // Position of each handle
+    std::vector<Node> dirty;             // Nodes changed since the last update
+    std::vector<uint32_t> dirty_index;   // Positions of dirty, reused by update()
+    std::vector<uint8_t> is_dirty;       // Per handle, avoids duplicates in dirty
+    size_t updated = 0;
+    bool ordered = true;                 // Arrays are in depth first order, subtree_end is valid
+
+    // Mark node dirty once
+    void mark_dirty(Node node);
+
+    // Restore depth first order after out of order insertions
+    void reorder();
+};
+
+#endif
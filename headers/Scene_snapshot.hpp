@@ -0,0 +1,62 @@
+#ifndef SCENE_SNAPSHOT_HPP
+#define SCENE_SNAPSHOT_HPP
+
+#pragma once
+
+#include "Render_math.hpp"
+#include "Renderer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Draws and camera of one simulation step. Items only reference meshes, which
+// must not change while snapshots of them can be rendered.
+struct Scene_snapshot {
+    std::vector<Renderer::Draw_item> items;
+    Mat4 view = Mat4::identity();
+    uint64_t sequence = 0;  // Number of the publish that made it, 0 before the first
+};
+
+// Hands snapshots from one update thread to one render thread without locks.
+// Three snapshots rotate between back (being written), middle (latest published)
+// and front (being rendered). publish() and acquire() each swap their snapshot
+// with the middle one in a single atomic exchange, so neither thread ever waits
+// and the render thread always reads a complete snapshot. Snapshots keep their
+// capacity, so steady state updates don't allocate.
+class Snapshot_buffer {
+public:
+    Snapshot_buffer() = default;
+
+    Snapshot_buffer(const Snapshot_buffer&) = delete;
+    Snapshot_buffer& operator=(const Snapshot_buffer&) = delete;
+
+    // Snapshot being written, update thread only
+    Scene_snapshot& back() { return slots[back_index].snapshot; }
+
+    // Publish back as the latest snapshot. Back becomes an older snapshot
+    // that has to be overwritten completely. Update thread only.
+    void publish();
+
+    // Latest published snapshot, unchanged until the next acquire(). Render thread only.
+    const Scene_snapshot& acquire();
+
+    // Snapshot returned by the last acquire(), render thread only
+    const Scene_snapshot& front() const { return slots[front_index].snapshot; }
+
+private:
+    static constexpr uint32_t FRESH = 4; // Set in middle while it holds an unread publish
+
+    // Own cache lines, so the threads don't contend on neighbouring vector headers
+    struct alignas(64) Slot {
+        Scene_snapshot snapshot;
+    };
+
+    Slot slots[3];
+    uint32_t back_index = 0;             // Update thread only
+    uint64_t published = 0;              // Update thread only
+    alignas(64) uint32_t front_index = 1; // Render thread only
+    alignas(64) std::atomic<uint32_t> middle{2}; // Index of the middle slot and FRESH
+};
+
+#endif
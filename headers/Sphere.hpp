@@ -5,6 +5,7 @@
 
 #include "Render_math.hpp"
 #include "Renderable.hpp"
+#include "Mesh_cache.hpp"
 
 #include <vector>
 #include <stdint.h>
@@ -24,6 +25,18 @@ public:
     // Get Model matrix
     const Mat4 get_model_matrix() const override;
 
+    // Returns ARGB fill color
+    uint32_t get_color() const override;
+
+    // Returns vector<Vec3> with per vertex normals
+    const std::vector<Vec3>& get_normals() const override;
+
+    // Returns vector<Vec2> with longitude and latitude texture coordinates
+    const std::vector<Vec2>& get_uvs() const override;
+
+    // Returns bounds of the sphere radius
+    Aabb get_bounds() const override;
+
     // SETTERS
     // Set position Vec3 {x, y, z}
     void set_position(const Vec3& _pos);
@@ -34,15 +47,20 @@ public:
     // Set scale Vec3 {x scale, y scale, z scale}
     void set_scale(const Vec3& _scale);
 
+    // Set ARGB fill color
+    void set_color(uint32_t _color);
+
 protected:
-    std::vector<Vec3> vertices;
-    std::vector<uint32_t> indices;
+    Mesh_cache::Handle mesh; // Shared by spheres of the same radius and segments
 
     Vec3 pos = {0, 0, 0};
     Vec3 rot = {0, 0, 0};
     Vec3 scale = {1, 1, 1};
+    uint32_t color = 0xFFFFFFFF;
+    float radius = 1.0f;
 
-    void generate_mesh(float radius, int latSegments, int longSegments);
+    // Generates vertices, normals, texture coordinates and indices of a sphere mesh
+    static Mesh_data generate_mesh(float radius, int latSegments, int longSegments);
 
 };
 
@@ -0,0 +1,92 @@
+#ifndef TEXTURE_HPP
+#define TEXTURE_HPP
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// ARGB texture with a full mip chain, sampled by filled rendering with texture
+// coordinates repeating outside [0, 1). Every level is stored in 4x4 texel tiles
+// of one cache line each, Morton ordered inside the tile, so a bilinear footprint
+// touches at most 4 lines whatever the orientation of the triangle. Together with
+// a mip level per triangle that keeps about one texel per sample, the lines a
+// triangle reads stay bounded under rotation and minification.
+class Texture {
+public:
+    enum class Filter {
+        Nearest,  // Texel the sample falls in
+        Bilinear  // Weighted 2x2 texels around the sample
+    };
+
+    Texture() = default;
+
+    // width x height ARGB texels in rows, mismatched sizes make an empty texture
+    Texture(int width, int height, const std::vector<uint32_t>& rows);
+
+    // Moving keeps the alignment of the storage, copies would lose it
+    Texture(Texture&&) = default;
+    Texture& operator=(Texture&&) = default;
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    // size x size checkerboard of cells x cells squares
+    static Texture checkerboard(int size, int cells, uint32_t color0, uint32_t color1);
+
+    // GETTERS
+    int get_width() const { return levels.empty() ? 0 : levels[0].width; }
+    int get_height() const { return levels.empty() ? 0 : levels[0].height; }
+
+    // Number of mip levels, 0 for an empty texture
+    int get_level_count() const { return int(levels.size()); }
+
+    // Returns filter used by sample()
+    Filter get_filter() const { return filter; }
+
+    // Texel x, y of a level
+    uint32_t get_texel(int level, int x, int y) const {
+        const Level& l = levels[level];
+        return texels[l.row_offset[y] + l.col_offset[x]];
+    }
+
+    // Level keeping about one texel per sample for a triangle covering
+    // texel_area texels of level 0 with sample_area samples
+    int select_level(float texel_area, float sample_area) const;
+
+    // Sample a level at u, v with the texture filter
+    uint32_t sample(int level, float u, float v) const {
+        return filter == Filter::Bilinear ? sample_bilinear(level, u, v) : sample_nearest(level, u, v);
+    }
+
+    // Texel of a level containing u, v
+    uint32_t sample_nearest(int level, float u, float v) const;
+
+    // Bilinear blend of the 2x2 texels of a level around u, v
+    uint32_t sample_bilinear(int level, float u, float v) const;
+
+    // SETTERS
+    // Set filter used by sample()
+    void set_filter(Filter _filter);
+
+protected:
+    static constexpr int TILE_SIZE = 4;  // 4x4 ARGB texels fill one 64 byte cache line
+    static constexpr size_t ALIGNMENT = 64 / sizeof(uint32_t); // Texels per cache line
+
+    // Texel x, y of a level is at row_offset[y] + col_offset[x] in texels, tiles
+    // in rows and Morton order inside a tile
+    struct Level {
+        int width, height;
+        float scale_x, scale_y;  // width and height for scaling texture coordinates
+        std::vector<uint32_t> row_offset, col_offset;
+    };
+
+    std::vector<Level> levels;
+    std::vector<uint32_t> texels; // Every level, tiles start on a cache line
+    Filter filter = Filter::Bilinear;
+
+    // Store a level of width x height texels in rows into its tiles
+    void store_level(int level, const uint32_t* rows);
+};
+
+#endif
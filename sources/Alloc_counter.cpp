@@ -0,0 +1,56 @@
+#include "Alloc_counter.hpp"
+
+#ifdef POLYRENDER_COUNT_ALLOCS
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocations{0};
+
+// Counted allocation, throws like the standard operator new
+static void* counted_alloc(size_t size, size_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+
+    void* p = nullptr;
+    if (align <= alignof(std::max_align_t)) p = std::malloc(size);
+    else if (posix_memalign(&p, align, size) != 0) p = nullptr;
+
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return counted_alloc(size, 0); }
+void* operator new[](size_t size) { return counted_alloc(size, 0); }
+void* operator new(size_t size, std::align_val_t align) { return counted_alloc(size, size_t(align)); }
+void* operator new[](size_t size, std::align_val_t align) { return counted_alloc(size, size_t(align)); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try { return counted_alloc(size, 0); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return counted_alloc(size, 0); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+uint64_t allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+uint64_t allocation_count() {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,306 @@
+#include "Capture.hpp"
+#include "Renderer.hpp"
+#include "Quantized_mesh.hpp"
+
+#include <cstring>
+
+// File layout: magic, version, width, height, ssaa factor, followed by chunks of
+// {tag, payload size, payload}. Unknown chunks are skipped on load.
+static const char CAPTURE_MAGIC[8] = {'P', 'R', 'C', 'A', 'P', 'T', 'U', 'R'};
+static const uint32_t CAPTURE_VERSION = 3;
+static const uint32_t CHUNK_MESH = 0x4853454d;  // "MESH"
+static const uint32_t CHUNK_FRAME = 0x4d415246; // "FRAM"
+
+// Append raw bytes to a chunk
+static void put_bytes(std::vector<uint8_t>& out, const void* data, size_t bytes) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), p, p + bytes);
+}
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    put_bytes(out, &value, sizeof(value));
+}
+
+static void put_mat4(std::vector<uint8_t>& out, const Mat4& mat) {
+    put_bytes(out, mat.m, sizeof(mat.m));
+}
+
+// FNV-1a style hash of bytes continuing from h, a word at a time
+static uint64_t hash_bytes(uint64_t h, const void* data, size_t bytes) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (; bytes >= sizeof(uint64_t); p += sizeof(uint64_t), bytes -= sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        h = (h ^ word) * 1099511628211ull;
+    }
+    for (; bytes > 0; ++p, --bytes) h = (h ^ *p) * 1099511628211ull;
+    return h;
+}
+
+// Hash of what a mesh chunk stores for an object
+static uint64_t hash_mesh(const Renderable& obj) {
+    const Quantized_mesh* quantized = obj.get_quantized();
+    const auto& normals = obj.get_normals();
+    const auto& colors = obj.get_colors();
+
+    uint64_t hash = 14695981039346656037ull;
+    if (quantized) {
+        hash = hash_bytes(hash, quantized->get_positions().data(), quantized->get_vertex_count() * sizeof(Vec3_u16));
+        const Mat4& dequantize = quantized->get_dequantize();
+        hash = hash_bytes(hash, dequantize.m, sizeof(dequantize.m));
+        for (const auto& cluster : quantized->get_clusters()) {
+            uint32_t fields[3] = {cluster.index_count, cluster.base_vertex, cluster.wide};
+            hash = hash_bytes(hash, fields, sizeof(fields));
+            if (cluster.wide) {
+                hash = hash_bytes(hash, quantized->get_indices32() + cluster.offset, cluster.index_count * sizeof(uint32_t));
+            } else {
+                hash = hash_bytes(hash, quantized->get_indices16() + cluster.offset, cluster.index_count * sizeof(uint16_t));
+            }
+        }
+    } else {
+        uint64_t counts[2] = {obj.get_vertices().size(), obj.get_indices().size()};
+        hash = hash_bytes(hash, counts, sizeof(counts));
+        hash = hash_bytes(hash, obj.get_vertices().data(), obj.get_vertices().size() * sizeof(Vec3));
+        hash = hash_bytes(hash, obj.get_indices().data(), obj.get_indices().size() * sizeof(uint32_t));
+    }
+    uint64_t attribute_counts[2] = {normals.size(), colors.size()};
+    hash = hash_bytes(hash, attribute_counts, sizeof(attribute_counts));
+    hash = hash_bytes(hash, normals.data(), normals.size() * sizeof(Vec3));
+    hash = hash_bytes(hash, colors.data(), colors.size() * sizeof(uint32_t));
+    return hash;
+}
+
+// Reads values from a loaded buffer with bounds checking
+struct Capture_cursor {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    bool get_bytes(void* dst, size_t bytes) {
+        if (!ok || bytes > size - pos) {
+            ok = false;
+            return false;
+        }
+        std::memcpy(dst, data + pos, bytes);
+        pos += bytes;
+        return true;
+    }
+
+    uint32_t get_u32() {
+        uint32_t value = 0;
+        get_bytes(&value, sizeof(value));
+        return value;
+    }
+
+    Mat4 get_mat4() {
+        Mat4 mat;
+        get_bytes(mat.m, sizeof(mat.m));
+        return mat;
+    }
+};
+
+// Load capture file
+bool Capture::load(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    std::vector<uint8_t> data;
+    uint8_t block[1 << 16];
+    size_t read;
+    while ((read = std::fread(block, 1, sizeof(block), file)) > 0) {
+        data.insert(data.end(), block, block + read);
+    }
+    std::fclose(file);
+
+    Capture_cursor in{data.data(), data.size()};
+
+    char magic[8];
+    if (!in.get_bytes(magic, sizeof(magic)) || std::memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) return false;
+    uint32_t version = in.get_u32();
+    if (version < 1 || version > CAPTURE_VERSION) return false;
+
+    width = static_cast<int>(in.get_u32());
+    height = static_cast<int>(in.get_u32());
+    ssaa_factor = static_cast<int>(in.get_u32());
+    meshes.clear();
+    frames.clear();
+
+    while (in.ok && in.pos < in.size) {
+        uint32_t tag = in.get_u32();
+        uint32_t bytes = in.get_u32();
+        if (!in.ok || bytes > in.size - in.pos) return false;
+        size_t end = in.pos + bytes;
+
+        if (tag == CHUNK_MESH) {
+            uint32_t vertex_count = in.get_u32();
+            uint32_t index_count = in.get_u32();
+            uint32_t normal_count = version >= 3 ? in.get_u32() : 0;
+            uint32_t color_count = version >= 3 ? in.get_u32() : 0;
+            if ((uint64_t(vertex_count) + normal_count) * sizeof(Vec3) +
+                (uint64_t(index_count) + color_count) * sizeof(uint32_t) > end - in.pos) return false;
+
+            Capture_mesh mesh;
+            mesh.vertices.resize(vertex_count);
+            mesh.indices.resize(index_count);
+            mesh.normals.resize(normal_count);
+            mesh.colors.resize(color_count);
+            in.get_bytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vec3));
+            in.get_bytes(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+            in.get_bytes(mesh.normals.data(), mesh.normals.size() * sizeof(Vec3));
+            in.get_bytes(mesh.colors.data(), mesh.colors.size() * sizeof(uint32_t));
+            meshes.push_back(std::move(mesh));
+        } else if (tag == CHUNK_FRAME) {
+            Capture_frame frame;
+            frame.view = in.get_mat4();
+            frame.projection = in.get_mat4();
+            frame.clear_color = in.get_u32();
+            frame.ssaa_factor = ssaa_factor;
+            if (version >= 2) {
+                frame.ssaa_factor = static_cast<int>(in.get_u32());
+                in.get_bytes(&frame.render_scale, sizeof(float));
+            }
+            if (version >= 3) {
+                frame.render_mode = static_cast<int>(in.get_u32());
+                frame.shade_mode = static_cast<int>(in.get_u32());
+                in.get_bytes(&frame.light_dir, sizeof(Vec3));
+                in.get_bytes(&frame.ambient, sizeof(float));
+            }
+            uint32_t object_count = in.get_u32();
+            if (uint64_t(object_count) * (sizeof(uint32_t) + sizeof(Mat4::m)) > end - in.pos) return false;
+            frame.objects.resize(object_count);
+            for (auto& object : frame.objects) {
+                object.mesh = in.get_u32();
+                object.model = in.get_mat4();
+                if (version >= 3) object.color = in.get_u32();
+                if (object.mesh >= meshes.size()) return false;
+            }
+            frames.push_back(std::move(frame));
+        }
+
+        if (!in.ok || in.pos > end) return false;
+        in.pos = end; // Skip unknown chunks and unread trailing data
+    }
+
+    return in.ok;
+}
+
+Capture_writer::~Capture_writer() {
+    close();
+}
+
+// Open capture file and write header
+bool Capture_writer::open(const std::string& path, const Renderer& renderer) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    frame_count = 0;
+    mesh_ids.clear();
+    mesh_count = 0;
+
+    chunk.clear();
+    put_bytes(chunk, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    put_u32(chunk, CAPTURE_VERSION);
+    put_u32(chunk, static_cast<uint32_t>(renderer.get_width()));
+    put_u32(chunk, static_cast<uint32_t>(renderer.get_height()));
+    put_u32(chunk, static_cast<uint32_t>(renderer.get_ssaa_factor()));
+    std::fwrite(chunk.data(), 1, chunk.size(), file);
+
+    return true;
+}
+
+// Record camera, projection and objects of the current frame
+void Capture_writer::record_frame(const Renderer& renderer) {
+    if (!file) return;
+
+    const auto& objects = renderer.get_objects();
+
+    // Write meshes not seen before
+    frame_ids.clear();
+    for (const auto* obj : objects) {
+        const Quantized_mesh* quantized = obj->get_quantized();
+        const auto& normals = obj->get_normals();
+        const auto& colors = obj->get_colors();
+        std::array<const void*, 4> key = {
+            quantized ? static_cast<const void*>(quantized) : &obj->get_vertices(),
+            quantized ? static_cast<const void*>(quantized) : &obj->get_indices(), &normals, &colors};
+
+        // Storage is hashed once per frame however many objects share it,
+        // storage reused for other data writes a new mesh
+        auto it = mesh_ids.find(key);
+        if (it != mesh_ids.end() && it->second.frame == frame_count) {
+            frame_ids.push_back(it->second.id);
+            continue;
+        }
+        uint64_t hash = hash_mesh(*obj);
+        if (it != mesh_ids.end() && it->second.hash == hash) {
+            it->second.frame = frame_count;
+        } else {
+            Recorded_mesh recorded = {mesh_count++, hash, frame_count};
+            it = mesh_ids.insert_or_assign(key, recorded).first;
+
+            // Quantized meshes are stored dequantized, replay draws them as floats
+            std::vector<Vec3> dequantized_verts;
+            std::vector<uint32_t> dequantized_inds;
+            if (quantized) {
+                dequantized_verts.resize(quantized->get_vertex_count());
+                dequantized_inds.resize(quantized->get_index_count());
+                for (size_t i = 0; i < dequantized_verts.size(); ++i) dequantized_verts[i] = quantized->get_position(i);
+                for (size_t i = 0; i < dequantized_inds.size(); ++i) dequantized_inds[i] = quantized->get_index(i);
+            }
+            const auto& verts = quantized ? dequantized_verts : obj->get_vertices();
+            const auto& inds = quantized ? dequantized_inds : obj->get_indices();
+
+            chunk.clear();
+            put_u32(chunk, static_cast<uint32_t>(verts.size()));
+            put_u32(chunk, static_cast<uint32_t>(inds.size()));
+            put_u32(chunk, static_cast<uint32_t>(normals.size()));
+            put_u32(chunk, static_cast<uint32_t>(colors.size()));
+            put_bytes(chunk, verts.data(), verts.size() * sizeof(Vec3));
+            put_bytes(chunk, inds.data(), inds.size() * sizeof(uint32_t));
+            put_bytes(chunk, normals.data(), normals.size() * sizeof(Vec3));
+            put_bytes(chunk, colors.data(), colors.size() * sizeof(uint32_t));
+            write_chunk(CHUNK_MESH);
+        }
+        frame_ids.push_back(it->second.id);
+    }
+
+    chunk.clear();
+    put_mat4(chunk, renderer.get_view_matrix());
+    put_mat4(chunk, renderer.get_projection_matrix());
+    put_u32(chunk, renderer.get_clear_color());
+    put_u32(chunk, static_cast<uint32_t>(renderer.get_ssaa_factor()));
+    float render_scale = renderer.get_render_scale();
+    put_bytes(chunk, &render_scale, sizeof(float));
+    put_u32(chunk, static_cast<uint32_t>(renderer.get_render_mode()));
+    put_u32(chunk, static_cast<uint32_t>(renderer.get_shade_mode()));
+    Vec3 light_dir = renderer.get_light_dir();
+    float ambient = renderer.get_ambient();
+    put_bytes(chunk, &light_dir, sizeof(Vec3));
+    put_bytes(chunk, &ambient, sizeof(float));
+    put_u32(chunk, static_cast<uint32_t>(objects.size()));
+    for (size_t i = 0; i < objects.size(); ++i) {
+        put_u32(chunk, frame_ids[i]);
+        put_mat4(chunk, objects[i]->get_model_matrix());
+        put_u32(chunk, objects[i]->get_color());
+    }
+    write_chunk(CHUNK_FRAME);
+
+    frame_count++;
+}
+
+// Flush and close capture file
+void Capture_writer::close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+// Write chunk header followed by the chunk payload
+void Capture_writer::write_chunk(uint32_t tag) {
+    uint32_t header[2] = {tag, static_cast<uint32_t>(chunk.size())};
+    std::fwrite(header, sizeof(uint32_t), 2, file);
+    std::fwrite(chunk.data(), 1, chunk.size(), file);
+}
@@ -0,0 +1,66 @@
+#include "Command_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// Record draw with an explicit model matrix
+void Command_list::draw(const Renderable& mesh, const Mat4& model, Draw_state state) {
+    commands.push_back({&mesh, model, state});
+}
+
+// Record draw with the mesh's own model matrix
+void Command_list::draw(const Renderable& mesh, Draw_state state) {
+    commands.push_back({&mesh, mesh.get_model_matrix(), state});
+}
+
+// Remove all commands
+void Command_list::reset() {
+    commands.clear();
+}
+
+Command_buffer::Command_buffer(size_t list_count) :
+    lists(std::max<size_t>(1, list_count)) {}
+
+// Reset all lists for the next frame
+void Command_buffer::reset() {
+    for (auto& l : lists) l.reset();
+}
+
+// Sort key of a command
+uint64_t Command_buffer::make_key(const Draw_command& command, const Mat4& view, uint32_t sequence) {
+    // View depth of the model origin, positive floats sort like their bits
+    Vec4 origin = view.transform(Vec4(command.model.m[0][3], command.model.m[1][3], command.model.m[2][3], 1.0f));
+    float depth = std::max(0.0f, -origin.z);
+    uint32_t depth_bits;
+    std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+    uint64_t state = (uint64_t(command.state.mode) << 4) | uint64_t(command.state.shade);
+    return (state << 56) | (uint64_t(depth_bits) << 24) | (sequence & 0xFFFFFF);
+}
+
+// Merge, sort and execute all lists on renderer
+void Command_buffer::submit(Renderer& renderer) {
+    sorted.clear();
+    const Mat4& view = renderer.get_view_matrix();
+
+    uint32_t sequence = 0;
+    for (const auto& l : lists) {
+        for (const auto& command : l.get_commands()) {
+            sorted.emplace_back(make_key(command, view, sequence++), &command);
+        }
+    }
+
+    std::sort(sorted.begin(), sorted.end(),
+        [](const std::pair<uint64_t, const Draw_command*>& a, const std::pair<uint64_t, const Draw_command*>& b) {
+            return a.first < b.first;
+        });
+
+    // Sorted commands go to the renderer as one batch
+    items.clear();
+    for (const auto& entry : sorted) {
+        const Draw_command& command = *entry.second;
+        items.push_back({command.mesh, command.model, command.state.mode, command.state.shade});
+    }
+
+    renderer.render_batch(items);
+}
@@ -1,31 +1,59 @@
 #include "Cube.hpp"
 
-Cube::Cube() {
-    vertices = {
+Cube::Cube() :
+    mesh(Mesh_cache::get({Mesh_shape::Cube}, generate_mesh)) {}
+
+// Generates vertices, texture coordinates and indices of the unit cube. Every
+// face has its own 4 vertices so it maps the whole texture.
+Mesh_data Cube::generate_mesh() {
+    const Vec3 corners[8] = {
         {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f},
         {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}
     };
 
-    indices = {
-        0, 1, 2, 2, 3, 0, // Back
-        4, 5, 6, 6, 7, 4, // Front
-        0, 1, 5, 5, 4, 0, // Bottom
-        2, 3, 7, 7, 6, 2, // Top
-        0, 3, 7, 7, 4, 0, // Left
-        1, 2, 6, 6, 5, 1  // Right
+    // Corners of each face, drawn as triangles 0 1 2 and 2 3 0
+    const int faces[6][4] = {
+        {0, 1, 2, 3}, // Back
+        {4, 5, 6, 7}, // Front
+        {0, 1, 5, 4}, // Bottom
+        {2, 3, 7, 6}, // Top
+        {0, 3, 7, 4}, // Left
+        {1, 2, 6, 5}  // Right
     };
+    const Vec2 face_uvs[4] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+
+    Mesh_data data;
+    for (const auto& face : faces) {
+        uint32_t first = uint32_t(data.vertices.size());
+        for (int k = 0; k < 4; ++k) {
+            data.vertices.push_back(corners[face[k]]);
+            data.uvs.push_back(face_uvs[k]);
+        }
+        for (uint32_t k : {0u, 1u, 2u, 2u, 3u, 0u}) data.indices.push_back(first + k);
+    }
+    return data;
 }
 
 // GETTERS
 
 // Returns vector<Vec3> with vertices
 const std::vector<Vec3>& Cube::get_vertices() const {
-    return vertices;
+    return mesh->vertices;
 }
 
 // Returns vector<uint32_t> with indices
 const std::vector<uint32_t>& Cube::get_indices() const {
-    return indices;
+    return mesh->indices;
+}
+
+// Returns per face texture coordinates
+const std::vector<Vec2>& Cube::get_uvs() const {
+    return mesh->uvs;
+}
+
+// Returns unit box bounds
+Aabb Cube::get_bounds() const {
+    return Aabb(Vec3(-0.5f, -0.5f, -0.5f), Vec3(0.5f, 0.5f, 0.5f));
 }
 
 // Returns model matrix for position, rotation and scale
@@ -39,6 +67,11 @@ const Mat4 Cube::get_model_matrix() const {
     return T * Rz * Ry * Rx * S;
 }
 
+// Returns ARGB fill color
+uint32_t Cube::get_color() const {
+    return color;
+}
+
 // SETTERS
 
 // Set position vector Vec3 {x, y, z}
@@ -56,3 +89,7 @@ void Cube::set_scale(const Vec3& _scale) {
     scale = _scale;
 }
 
+// Set ARGB fill color
+void Cube::set_color(uint32_t _color) {
+    color = _color;
+}
@@ -0,0 +1,82 @@
+#include "Frame_controller.hpp"
+#include "Renderer.hpp"
+
+#include <algorithm>
+
+Frame_controller::Frame_controller(double target_ms, int max_ssaa) :
+    target_ms(target_ms) {
+
+    // Reduced resolution levels below native, SSAA levels above
+    for (float scale : {0.5f, 0.625f, 0.75f, 0.875f}) levels.push_back({scale, 1});
+    for (int factor = 1; factor <= std::max(1, max_ssaa); ++factor) levels.push_back({1.0f, factor});
+
+    level = 4; // Native resolution without SSAA
+}
+
+// Record time of the last frame
+bool Frame_controller::update(double frame_ms) {
+    history[history_next] = frame_ms;
+    history_next = (history_next + 1) % HISTORY;
+    history_count = std::min(history_count + 1, HISTORY);
+
+    if (cooldown > 0) cooldown--;
+
+    float cost = levels[level].cost();
+
+    // Spike over budget, drop right away to the level predicted to fit
+    if (frame_ms > target_ms * 1.25) {
+        int next = level;
+        while (next > 0 && frame_ms * levels[next].cost() / cost > target_ms * 0.85) next--;
+        if (next != level) {
+            select(next);
+            return true;
+        }
+        return false;
+    }
+
+    if (cooldown > 0 || history_count < HISTORY) return false;
+
+    double average = get_average_ms();
+
+    // Slowly over budget, step down one level
+    if (average > target_ms * 0.95 && level > 0) {
+        select(level - 1);
+        return true;
+    }
+
+    // Step up when the next level is predicted to stay well inside budget
+    if (level + 1 < (int)levels.size() && average * levels[level + 1].cost() / cost < target_ms * 0.75) {
+        select(level + 1);
+        return true;
+    }
+
+    return false;
+}
+
+// Apply current quality level to a renderer
+void Frame_controller::apply(Renderer& renderer) const {
+    const Level& current = levels[level];
+    if (renderer.get_ssaa_factor() != current.ssaa_factor) renderer.enable_ssaa(current.ssaa_factor);
+    if (renderer.get_render_scale() != current.render_scale) renderer.set_render_scale(current.render_scale);
+}
+
+// Preallocate renderer buffers for the most expensive level
+void Frame_controller::reserve(Renderer& renderer) const {
+    renderer.reserve_render_target(levels.back().ssaa_factor);
+}
+
+// Average of the recent frame times
+double Frame_controller::get_average_ms() const {
+    if (history_count == 0) return 0.0;
+    double total = 0.0;
+    for (int i = 0; i < history_count; ++i) total += history[i];
+    return total / history_count;
+}
+
+// Select level
+void Frame_controller::select(int next) {
+    level = next;
+    history_count = 0;
+    history_next = 0;
+    cooldown = COOLDOWN;
+}
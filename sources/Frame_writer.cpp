@@ -0,0 +1,237 @@
+#include "Frame_writer.hpp"
+#include "Renderer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+Frame_writer::Frame_writer(size_t ring_size) :
+    ring(std::max<size_t>(1, ring_size)) {}
+
+Frame_writer::~Frame_writer() {
+    close();
+}
+
+// Start writing frames of width x height
+bool Frame_writer::open(const std::string& _path, Format _format, int _width, int _height, int fps) {
+    close();
+
+    path = _path;
+    format = _format;
+    width = _width;
+    height = _height;
+    failed = false;
+    closing = false;
+    head = tail = queued = 0;
+    frames_submitted = frames_written = stalls = 0;
+
+    if (format != Format::Ppm) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+
+        // Frames are written in one call each, stdio buffering would only add a copy
+        std::setvbuf(file, nullptr, _IONBF, 0);
+
+        if (format == Format::Y4m) {
+            std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, fps);
+        }
+    }
+
+    // Preallocate the ring and the encode buffer so steady state never allocates
+    for (auto& slot : ring) slot.pixels.resize(size_t(width) * height);
+    switch (format) {
+        case Format::Raw: encoded.reserve(size_t(width) * height * 4); break;
+        case Format::Ppm: encoded.reserve(size_t(width) * height * 3 + 32); break;
+        case Format::Y4m: encoded.reserve(size_t(width) * height * 3 + 6); break;
+    }
+
+    open_ = true;
+    writer = std::thread(&Frame_writer::writer_loop, this);
+    return true;
+}
+
+// Queue a width * height ARGB frame, blocks while the ring is full
+bool Frame_writer::write(const uint32_t* pixels) {
+    if (!open_) return false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (queued == ring.size()) {
+        stalls++;
+        not_full.wait(lock, [this] { return queued < ring.size() || failed; });
+    }
+    if (failed) return false;
+
+    // The slot is not touched by the writer until it is queued
+    Slot& slot = ring[head];
+    lock.unlock();
+    std::memcpy(slot.pixels.data(), pixels, slot.pixels.size() * sizeof(uint32_t));
+    lock.lock();
+
+    slot.frame = frames_submitted++;
+    head = (head + 1) % ring.size();
+    queued++;
+    lock.unlock();
+    not_empty.notify_one();
+    return true;
+}
+
+// Queue the resolved framebuffer of renderer
+bool Frame_writer::write(const Renderer& renderer) {
+    if (renderer.get_width() != width || renderer.get_height() != height) return false;
+    return write(renderer.get_framebuffer());
+}
+
+// Write queued frames and stop the writer thread
+bool Frame_writer::close() {
+    if (!open_) return !failed;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    not_empty.notify_one();
+    writer.join();
+
+    if (file) {
+        if (std::fclose(file) != 0) failed = true;
+        file = nullptr;
+    }
+
+    open_ = false;
+    return !failed;
+}
+
+// Frames written to disk
+uint64_t Frame_writer::get_frames_written() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames_written;
+}
+
+// Calls to write() that had to wait for a free buffer
+uint64_t Frame_writer::get_stalls() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stalls;
+}
+
+// Format from file extension
+Frame_writer::Format Frame_writer::format_from_path(const std::string& path) {
+    auto ends_with = [&path](const char* ext) {
+        size_t n = std::strlen(ext);
+        return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (ends_with(".ppm")) return Format::Ppm;
+    if (ends_with(".y4m")) return Format::Y4m;
+    return Format::Raw;
+}
+
+// Thread body, encodes and writes slots until closed and drained
+void Frame_writer::writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        not_empty.wait(lock, [this] { return queued > 0 || closing; });
+        if (queued == 0) return;
+
+        // Encode outside the lock, write() never touches a queued slot
+        const Slot& slot = ring[tail];
+        lock.unlock();
+        encode(slot);
+        bool ok = flush_frame(slot.frame);
+        lock.lock();
+
+        tail = (tail + 1) % ring.size();
+        queued--;
+        if (ok) frames_written++;
+        else failed = true;
+        not_full.notify_one();
+
+        if (failed) {
+            queued = 0;
+            return;
+        }
+    }
+}
+
+// Encode a frame into encoded
+void Frame_writer::encode(const Slot& slot) {
+    const uint32_t* src = slot.pixels.data();
+    size_t count = slot.pixels.size();
+    encoded.clear();
+
+    switch (format) {
+        case Format::Raw: {
+            encoded.resize(count * 4);
+            uint8_t* out = encoded.data();
+            for (size_t i = 0; i < count; ++i) {
+                uint32_t c = src[i];
+                out[i * 4 + 0] = uint8_t(c >> 16);
+                out[i * 4 + 1] = uint8_t(c >> 8);
+                out[i * 4 + 2] = uint8_t(c);
+                out[i * 4 + 3] = uint8_t(c >> 24);
+            }
+            break;
+        }
+        case Format::Ppm: {
+            char header[32];
+            int n = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+            encoded.assign(header, header + n);
+            encoded.resize(n + count * 3);
+            uint8_t* out = encoded.data() + n;
+            for (size_t i = 0; i < count; ++i) {
+                uint32_t c = src[i];
+                out[i * 3 + 0] = uint8_t(c >> 16);
+                out[i * 3 + 1] = uint8_t(c >> 8);
+                out[i * 3 + 2] = uint8_t(c);
+            }
+            break;
+        }
+        case Format::Y4m: {
+            static const char frame_header[] = "FRAME\n";
+            encoded.assign(frame_header, frame_header + 6);
+            encoded.resize(6 + count * 3);
+            uint8_t* y = encoded.data() + 6;
+            uint8_t* u = y + count;
+            uint8_t* v = u + count;
+            for (size_t i = 0; i < count; ++i) {
+                int r = (src[i] >> 16) & 0xFF, g = (src[i] >> 8) & 0xFF, b = src[i] & 0xFF;
+                y[i] = uint8_t(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                u[i] = uint8_t(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                v[i] = uint8_t(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+            break;
+        }
+    }
+}
+
+// Write encoded to its file
+bool Frame_writer::flush_frame(uint64_t frame) {
+    if (format != Format::Ppm) {
+        return std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+    }
+
+    FILE* out = std::fopen(frame_path(frame).c_str(), "wb");
+    if (!out) return false;
+    std::setvbuf(out, nullptr, _IONBF, 0);
+    bool ok = std::fwrite(encoded.data(), 1, encoded.size(), out) == encoded.size();
+    return std::fclose(out) == 0 && ok;
+}
+
+// Path of frame for PPM sequences, the last run of # is the zero padded frame
+// number, without one _##### is inserted before the extension
+std::string Frame_writer::frame_path(uint64_t frame) const {
+    std::string pattern = path;
+    size_t end = pattern.rfind('#');
+    if (end == std::string::npos) {
+        size_t dot = pattern.rfind('.');
+        size_t slash = pattern.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = pattern.size();
+        pattern.insert(dot, "_#####");
+        end = dot + 5;
+    }
+
+    size_t begin = end;
+    while (begin > 0 && pattern[begin - 1] == '#') begin--;
+    size_t digits = end - begin + 1;
+
+    std::string number = std::to_string(frame);
+    if (number.size() < digits) number.insert(0, digits - number.size(), '0');
+    return pattern.replace(begin, digits, number);
+}
@@ -0,0 +1,113 @@
+#include "Job_system.hpp"
+
+#include <algorithm>
+
+Job_system::Job_system(unsigned threads) {
+    worker_count = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < worker_count; ++i) queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 1; i < worker_count; ++i) this->threads.emplace_back(&Job_system::worker_loop, this, i);
+}
+
+Job_system::~Job_system() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+// Run job for every index in [0, count) and wait
+void Job_system::parallel_for(size_t count, const Job& job) {
+    if (count == 0) return;
+
+    // Nothing to share, run inline
+    if (worker_count == 1 || count == 1) {
+        for (size_t i = 0; i < count; ++i) job(i, 0);
+        return;
+    }
+
+    // Deal jobs round robin
+    for (size_t i = 0; i < count; ++i) {
+        Queue& q = *queues[i % worker_count];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.head == q.jobs.size()) {
+            q.jobs.clear();
+            q.head = 0;
+        }
+        q.jobs.push_back(i);
+    }
+    remaining.store(count);
+
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        current = &job;
+        generation++;
+    }
+    wake.notify_all();
+
+    drain(0, job);
+
+    // Wait for jobs still running on other workers
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    done.wait(lock, [this] { return remaining.load() == 0 && active == 0; });
+    current = nullptr;
+}
+
+// Thread body of workers 1..n
+void Job_system::worker_loop(unsigned worker) {
+    uint64_t seen = 0;
+    for (;;) {
+        const Job* job;
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait(lock, [&] { return stopping || (current && generation != seen); });
+            if (stopping) return;
+            seen = generation;
+            job = current;
+            active++;
+        }
+        drain(worker, *job);
+
+        // parallel_for returns only once no worker can touch its job anymore
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        if (--active == 0) done.notify_all();
+    }
+}
+
+// Run jobs until every queue is empty
+void Job_system::drain(unsigned worker, const Job& job) {
+    size_t index;
+    while (take(worker, index)) {
+        job(index, worker);
+        if (remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            done.notify_all();
+        }
+    }
+}
+
+// Take job from own queue or steal one
+bool Job_system::take(unsigned worker, size_t& index) {
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.head < own.jobs.size()) {
+            index = own.jobs.back();
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+
+    for (unsigned i = 1; i < worker_count; ++i) {
+        Queue& victim = *queues[(worker + i) % worker_count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.head < victim.jobs.size()) {
+            index = victim.jobs[victim.head++];
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,56 @@
+#include "Mesh_cache.hpp"
+
+#include <algorithm>
+
+// Returns mesh for key, generated on first use or after every holder released it
+Mesh_cache::Handle Mesh_cache::get(const Mesh_key& key, const std::function<Mesh_data()>& generate) {
+    State& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.meshes.find(key);
+        if (it != s.meshes.end()) {
+            if (Handle mesh = it->second.lock()) return mesh;
+        }
+    }
+
+    // Generated unlocked, threads racing on the same key keep the first mesh stored
+    Handle mesh = std::make_shared<const Mesh_data>(generate());
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.meshes.find(key);
+    if (it != s.meshes.end()) {
+        if (Handle stored = it->second.lock()) return stored;
+        it->second = mesh;
+        return mesh;
+    }
+
+    // Drop entries of released meshes once the map has doubled since the last
+    // sweep, so each insert pays a constant share
+    if (s.meshes.size() >= s.sweep_size) {
+        for (auto entry = s.meshes.begin(); entry != s.meshes.end();) {
+            if (entry->second.expired()) entry = s.meshes.erase(entry);
+            else ++entry;
+        }
+        s.sweep_size = std::max<size_t>(64, 2 * s.meshes.size());
+    }
+
+    s.meshes.emplace(key, mesh);
+    return mesh;
+}
+
+// Number of cached meshes still held by objects
+size_t Mesh_cache::get_live_count() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    size_t count = 0;
+    for (const auto& entry : s.meshes) {
+        if (!entry.second.expired()) count++;
+    }
+    return count;
+}
+
+// Cache state lives in a function static so objects built during static initialization work
+Mesh_cache::State& Mesh_cache::state() {
+    static State instance;
+    return instance;
+}
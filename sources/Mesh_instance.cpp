@@ -0,0 +1,92 @@
+#include "Mesh_instance.hpp"
+
+// Float storage of quantized instances, always empty
+static const std::vector<Vec3> empty_vertices;
+static const std::vector<uint32_t> empty_indices;
+
+Mesh_instance::Mesh_instance(const std::vector<Vec3>& vertices, const std::vector<uint32_t>& indices) :
+    vertices(&vertices), indices(&indices) {
+
+    update_bounds();
+}
+
+Mesh_instance::Mesh_instance(const Quantized_mesh& mesh) :
+    vertices(&empty_vertices), indices(&empty_indices), quantized(&mesh), bounds(mesh.get_bounds()) {}
+
+// GETTERS
+// Returns vector<Vec3> with vertices
+const std::vector<Vec3>& Mesh_instance::get_vertices() const {
+    return *vertices;
+}
+
+// Returns vector<uint32_t> with indices
+const std::vector<uint32_t>& Mesh_instance::get_indices() const {
+    return *indices;
+}
+
+// Returns model matrix
+const Mat4 Mesh_instance::get_model_matrix() const {
+    return model;
+}
+
+// Returns bounds of the referenced vertices
+Aabb Mesh_instance::get_bounds() const {
+    return bounds;
+}
+
+// Returns quantized mesh, null when drawing float vertices
+const Quantized_mesh* Mesh_instance::get_quantized() const {
+    return quantized;
+}
+
+// Returns vector<Vec3> with per vertex normals
+const std::vector<Vec3>& Mesh_instance::get_normals() const {
+    return *normals;
+}
+
+// Returns vector<uint32_t> with per vertex colors
+const std::vector<uint32_t>& Mesh_instance::get_colors() const {
+    return *colors;
+}
+
+// Returns vector<Vec2> with per vertex texture coordinates
+const std::vector<Vec2>& Mesh_instance::get_uvs() const {
+    return *uvs;
+}
+
+// Returns ARGB fill color
+uint32_t Mesh_instance::get_color() const {
+    return color;
+}
+
+// SETTERS
+// Set model matrix
+void Mesh_instance::set_model_matrix(const Mat4& _model) {
+    model = _model;
+}
+
+// Set per vertex normals owned elsewhere
+void Mesh_instance::set_normals(const std::vector<Vec3>& _normals) {
+    normals = &_normals;
+}
+
+// Set per vertex colors owned elsewhere
+void Mesh_instance::set_colors(const std::vector<uint32_t>& _colors) {
+    colors = &_colors;
+}
+
+// Set per vertex texture coordinates owned elsewhere
+void Mesh_instance::set_uvs(const std::vector<Vec2>& _uvs) {
+    uvs = &_uvs;
+}
+
+// Set ARGB fill color
+void Mesh_instance::set_color(uint32_t _color) {
+    color = _color;
+}
+
+// Recompute bounds after the referenced vertices were edited in place
+void Mesh_instance::update_bounds() {
+    bounds = quantized ? quantized->get_bounds() : Aabb();
+    for (const auto& v : *vertices) bounds.expand(v);
+}
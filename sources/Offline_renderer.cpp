@@ -0,0 +1,46 @@
+#include "Offline_renderer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+Offline_renderer::Offline_renderer(int width, int height, unsigned count) {
+    if (count == 0) count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; ++i) contexts.push_back(std::make_unique<Renderer>(width, height));
+}
+
+// Render frames [0, count). Frames are claimed in increasing order, so the next
+// frame to emit is always being rendered and a finished context waiting for its
+// turn can't deadlock. The context is reused only after its frame was emitted.
+void Offline_renderer::render(size_t count, const Setup& setup, const Emit& emit) {
+    std::atomic<size_t> next_frame{0};
+    size_t next_emit = 0;
+    std::mutex mutex;
+    std::condition_variable turn;
+
+    auto run = [&](unsigned context) {
+        Renderer& renderer = *contexts[context];
+        for (;;) {
+            size_t frame = next_frame.fetch_add(1);
+            if (frame >= count) return;
+
+            setup(frame, context, renderer);
+            renderer.show();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            turn.wait(lock, [&] { return next_emit == frame; });
+            emit(frame, renderer);
+            next_emit++;
+            lock.unlock();
+            turn.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    unsigned workers = unsigned(std::min<size_t>(contexts.size(), count));
+    for (unsigned i = 1; i < workers; ++i) threads.emplace_back(run, i);
+    run(0);
+    for (auto& t : threads) t.join();
+}
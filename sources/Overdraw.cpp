@@ -0,0 +1,57 @@
+#include "Overdraw.hpp"
+
+#include <algorithm>
+
+// Grow counters to hold at least samples entries
+void Overdraw::reserve(size_t samples) {
+    if (tested.size() < samples) {
+        tested.resize(samples, 0);
+        written.resize(samples, 0);
+    }
+}
+
+// Zero the counters of the first samples entries
+void Overdraw::clear(size_t samples) {
+    reserve(samples);
+    std::fill(tested.begin(), tested.begin() + samples, 0);
+    std::fill(written.begin(), written.begin() + samples, 0);
+}
+
+// Sum the counters of the first samples entries
+Overdraw_stats Overdraw::summarize(size_t samples) const {
+    Overdraw_stats stats;
+    for (size_t i = 0; i < samples && i < tested.size(); ++i) {
+        uint32_t t = tested[i], w = written[i];
+        stats.fragments += t;
+        stats.passed += w;
+        if (w > 1) stats.overwritten += w - 1;
+        if (t > 0) stats.covered++;
+        stats.max_complexity = std::max(stats.max_complexity, t);
+    }
+    return stats;
+}
+
+// Replace the first samples colors by the heatmap color of their depth complexity
+void Overdraw::apply_heatmap(uint32_t* colors, size_t samples) const {
+    for (size_t i = 0; i < samples && i < tested.size(); ++i) colors[i] = heat_color(tested[i]);
+}
+
+// Heatmap color of a depth complexity
+uint32_t Overdraw::heat_color(uint32_t complexity) {
+    static const uint32_t ramp[] = {
+        0xFF000000, // 0
+        0xFF000080, // 1
+        0xFF0000FF, // 2
+        0xFF00FFFF, // 3
+        0xFF00FF00, // 4
+        0xFFFFFF00, // 5-7
+        0xFFFF8000, // 8-11
+        0xFFFF0000, // 12-15
+        0xFFFFFFFF  // 16+
+    };
+    if (complexity < 5) return ramp[complexity];
+    if (complexity < 8) return ramp[5];
+    if (complexity < 12) return ramp[6];
+    if (complexity < 16) return ramp[7];
+    return ramp[8];
+}
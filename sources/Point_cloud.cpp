@@ -0,0 +1,27 @@
+#include "Point_cloud.hpp"
+
+#include <algorithm>
+#include <utility>
+
+Point_cloud::Point_cloud(std::vector<Vec3> _positions, std::vector<uint32_t> _colors) :
+    positions(std::move(_positions)), colors(std::move(_colors)) {
+
+    if (colors.size() != positions.size()) colors.clear();
+    for (const auto& p : positions) bounds.expand(p);
+}
+
+// SETTERS
+// Set ARGB color of points without their own color
+void Point_cloud::set_color(uint32_t _color) {
+    color = _color;
+}
+
+// Set model matrix
+void Point_cloud::set_model_matrix(const Mat4& _model) {
+    model = _model;
+}
+
+// Set side of the square splat in window pixels
+void Point_cloud::set_point_size(float size) {
+    point_size = std::max(1.0f, size);
+}
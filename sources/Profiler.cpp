@@ -0,0 +1,102 @@
+#include "Profiler.hpp"
+
+// Reset timings and counters, keeps frame number
+void Frame_stats::reset() {
+    for (double& t : stage_ms) t = 0.0;
+    for (uint64_t& c : counters) c = 0;
+}
+
+// Sum of all stage timings
+double Frame_stats::total_ms() const {
+    double total = 0.0;
+    for (double t : stage_ms) total += t;
+    return total;
+}
+
+// Name of stage
+const char* Frame_stats::name(Stage stage) {
+    switch (stage) {
+        case Stage::Occlusion: return "occlusion";
+        case Stage::Transform: return "transform";
+        case Stage::Clip:      return "clip";
+        case Stage::Raster:    return "raster";
+        case Stage::Shade:     return "shade";
+        case Stage::Clear:     return "clear";
+        case Stage::Resolve:   return "resolve";
+        case Stage::Present:   return "present";
+        case Stage::Count:     break;
+    }
+    return "unknown";
+}
+
+// Name of counter
+const char* Frame_stats::name(Counter counter) {
+    switch (counter) {
+        case Counter::Triangles_submitted:  return "triangles_submitted";
+        case Counter::Triangles_rejected:   return "triangles_rejected";
+        case Counter::Triangles_clipped:    return "triangles_clipped";
+        case Counter::Triangles_degenerate: return "triangles_degenerate";
+        case Counter::Lines_drawn:          return "lines_drawn";
+        case Counter::Pixels_drawn:         return "pixels_drawn";
+        case Counter::Depth_pass:           return "depth_pass";
+        case Counter::Depth_fail:           return "depth_fail";
+        case Counter::Pixels_shaded:        return "pixels_shaded";
+        case Counter::Objects_occluded:     return "objects_occluded";
+        case Counter::Objects_outside:      return "objects_outside";
+        case Counter::Pixels_damaged:       return "pixels_damaged";
+        case Counter::Points_submitted:     return "points_submitted";
+        case Counter::Points_rejected:      return "points_rejected";
+        case Counter::Count:                break;
+    }
+    return "unknown";
+}
+
+Profiler::~Profiler() {
+    close_csv();
+}
+
+// Finish frame, stores it as last frame and streams it to CSV
+void Profiler::end_frame() {
+    last = current;
+
+    if (csv) {
+        std::fprintf(csv, "%llu", static_cast<unsigned long long>(last.frame));
+        for (int s = 0; s < static_cast<int>(Stage::Count); ++s) {
+            std::fprintf(csv, ",%.4f", last.stage_ms[s]);
+        }
+        for (int c = 0; c < static_cast<int>(Counter::Count); ++c) {
+            std::fprintf(csv, ",%llu", static_cast<unsigned long long>(last.counters[c]));
+        }
+        std::fprintf(csv, "\n");
+    }
+
+    current.reset();
+    current.frame++;
+}
+
+// Stream every finished frame to a CSV file
+bool Profiler::open_csv(const std::string& path) {
+    close_csv();
+    csv = std::fopen(path.c_str(), "w");
+    if (!csv) return false;
+
+    // Header row
+    std::fprintf(csv, "frame");
+    for (int s = 0; s < static_cast<int>(Stage::Count); ++s) {
+        std::fprintf(csv, ",%s_ms", Frame_stats::name(static_cast<Stage>(s)));
+    }
+    for (int c = 0; c < static_cast<int>(Counter::Count); ++c) {
+        std::fprintf(csv, ",%s", Frame_stats::name(static_cast<Counter>(c)));
+    }
+    std::fprintf(csv, "\n");
+
+    return true;
+}
+
+// Stop streaming to CSV
+void Profiler::close_csv() {
+    if (csv) {
+        std::fclose(csv);
+        csv = nullptr;
+    }
+}
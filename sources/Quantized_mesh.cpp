@@ -0,0 +1,86 @@
+#include "Quantized_mesh.hpp"
+
+#include <algorithm>
+
+Quantized_mesh::Quantized_mesh(const std::vector<Vec3>& vertices, const std::vector<uint32_t>& indices) {
+    for (const auto& v : vertices) bounds.expand(v);
+
+    // One step per 1/65535 of the extent, flat axes keep a unit step
+    Vec3 origin = bounds.empty() ? Vec3() : bounds.min;
+    Vec3 extent = bounds.empty() ? Vec3() : bounds.max - bounds.min;
+    Vec3 step(extent.x > 0.0f ? extent.x / 65535.0f : 1.0f,
+              extent.y > 0.0f ? extent.y / 65535.0f : 1.0f,
+              extent.z > 0.0f ? extent.z / 65535.0f : 1.0f);
+    dequantize = Mat4::translation(origin.x, origin.y, origin.z) * Mat4::scale(step.x, step.y, step.z);
+
+    auto quantize = [](float value, float origin, float step) {
+        return uint16_t(std::clamp(std::lround((value - origin) / step), 0l, 65535l));
+    };
+    positions.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        positions[i].x = quantize(vertices[i].x, origin.x, step.x);
+        positions[i].y = quantize(vertices[i].y, origin.y, step.y);
+        positions[i].z = quantize(vertices[i].z, origin.z, step.z);
+    }
+
+    // Clusters grow by whole triangles while their vertices span at most 65536,
+    // a triangle spanning more on its own goes into a wide cluster
+    index_count = indices.size();
+    uint32_t low = 0, high = 0;
+    auto close = [this, &indices, &low]() {
+        Cluster& c = clusters.back();
+        if (c.wide) return;
+        c.base_vertex = low;
+        for (size_t i = c.first_index; i < size_t(c.first_index) + c.index_count; ++i) {
+            indices16.push_back(uint16_t(indices[i] - low));
+        }
+    };
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        size_t end = std::min(i + 3, indices.size());
+        auto range = std::minmax_element(indices.begin() + i, indices.begin() + end);
+        bool wide = *range.second - *range.first > 65535;
+
+        bool fits = !clusters.empty() && clusters.back().wide == wide &&
+                    (wide || std::max(high, *range.second) - std::min(low, *range.first) <= 65535);
+        if (!fits) {
+            if (!clusters.empty()) close();
+            uint32_t offset = uint32_t(wide ? indices32.size() : indices16.size());
+            clusters.push_back({uint32_t(i), 0, 0, offset, wide});
+            low = *range.first;
+            high = *range.second;
+        }
+
+        Cluster& c = clusters.back();
+        c.index_count += uint32_t(end - i);
+        if (wide) indices32.insert(indices32.end(), indices.begin() + i, indices.begin() + end);
+        low = std::min(low, *range.first);
+        high = std::max(high, *range.second);
+    }
+    if (!clusters.empty()) close();
+}
+
+// Returns cluster holding index i, the last one starting at or before it
+const Quantized_mesh::Cluster& Quantized_mesh::find_cluster(size_t i) const {
+    auto it = std::upper_bound(clusters.begin(), clusters.end(), i,
+        [](size_t value, const Cluster& c) { return value < c.first_index; });
+    return *(it - 1);
+}
+
+// Returns index i
+uint32_t Quantized_mesh::get_index(size_t i) const {
+    const Cluster& c = find_cluster(i);
+    size_t local = c.offset + (i - c.first_index);
+    return c.wide ? indices32[local] : c.base_vertex + indices16[local];
+}
+
+// Returns dequantized model space position of vertex i
+Vec3 Quantized_mesh::get_position(size_t i) const {
+    Vec4 p = dequantize.transform(positions[i]);
+    return Vec3(p.x, p.y, p.z);
+}
+
+// Returns bytes used by positions and indices
+size_t Quantized_mesh::get_memory() const {
+    return positions.size() * sizeof(Vec3_u16) + indices16.size() * sizeof(uint16_t) +
+           indices32.size() * sizeof(uint32_t) + clusters.size() * sizeof(Cluster);
+}
@@ -1,18 +1,39 @@
 #include "Renderer.hpp"
+#include "Quantized_mesh.hpp"
+#include "Point_cloud.hpp"
+#include "Texture.hpp"
 
 Renderer::Renderer(int width, int height) :
     width(width), height(height) {
 
     size = width * height; // Store framebuffer size for fast access
-    
+
+    // Framebuffer is owned by the renderer so it can render without a display
+    framebuffer = new uint32_t[size];
+    std::fill(framebuffer, framebuffer + size, 0);
+
     // Resize zbuffer for screen size.
     zbuffer.resize(size, std::numeric_limits<float>::infinity());
+    update_layout(width, height);
+    viewport = {0, 0, width, height};
+    scissor = viewport;
 
     // Set view and projection to eye mat standard
     view = Mat4::identity();
     projection = Mat4::identity();
 }
 
+Renderer::~Renderer() {
+    if (ximage) {
+        ximage->data = nullptr; // Framebuffer is freed below, not by X
+        XDestroyImage(ximage);
+    }
+    if (display) XCloseDisplay(display);
+
+    delete[] framebuffer;
+    delete[] ssaa_buffer;
+}
+
 // Inits display window
 void Renderer::init_x11() {
     display = XOpenDisplay(NULL); // Creates display
@@ -26,8 +47,6 @@ void Renderer::init_x11() {
     XMapWindow(display, window);
     gc = DefaultGC(display, screen);
 
-    framebuffer = new uint32_t[size]; // 1D array with all pixels
-
     ximage = XCreateImage(display, DefaultVisual(display, screen), 24,
                           ZPixmap, 0, (char*)framebuffer,
                           width, height, 32, 0);
@@ -35,29 +54,118 @@ void Renderer::init_x11() {
 
 // Enable SSAA and set factor
 void Renderer::enable_ssaa(int factor) {
-    // Check if we are enabeling or disabeling SSAA
-    if (factor <= 1) {
+    ssaa_factor = std::max(1, factor);
+    update_render_target();
+}
+
+// Disable SSAA
+void Renderer::disable_ssaa() {
+    enable_ssaa(0);
+    return;
+}
+
+// Scale internal render resolution
+void Renderer::set_render_scale(float scale) {
+    render_scale = std::clamp(scale, 0.25f, 1.0f);
+    update_render_target();
+}
+
+// Preallocate sample buffers up to an SSAA factor
+void Renderer::reserve_render_target(int max_factor) {
+    max_factor = std::max(1, max_factor);
+    int samples_x = (width * max_factor + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    int samples_y = (height * max_factor + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    reserve_samples(samples_x * samples_y);
+}
+
+// Resize render target after SSAA factor or render scale changed
+void Renderer::update_render_target() {
+    int target_width = std::max(1, int(std::lround(width * render_scale * ssaa_factor)));
+    int target_height = std::max(1, int(std::lround(height * render_scale * ssaa_factor)));
+
+    // Render straight into the framebuffer when sample and window grids match and samples are linear
+    viewport = {0, 0, target_width, target_height};
+    scissor = viewport;
+    scene_valid = false;
+    if (target_width == width && target_height == height && !tiled) {
         ssaa = false;
-        zbuffer.resize(size, std::numeric_limits<float>::infinity());
+        update_layout(width, height);
+        reserve_depth(size);
         return;
     }
 
     ssaa = true;
-    ssaa_factor = factor;
-    ssaa_width = width * ssaa_factor;
-    ssaa_height = height * ssaa_factor;
+    ssaa_width = target_width;
+    ssaa_height = target_height;
     ssaa_samples = ssaa_factor * ssaa_factor;
-    ssaa_size = ssaa_height * ssaa_width;
-    ssaa_buffer = new uint32_t[ssaa_size];
-    zbuffer.resize(ssaa_size, std::numeric_limits<float>::infinity());
+    ssaa_size = update_layout(ssaa_width, ssaa_height);
+    reserve_samples(ssaa_size);
+
+    // Tables mapping window pixels to sample rows and columns
+    auto build = [](int src, int dst, std::vector<int>& first, std::vector<int>& last, std::vector<int>& weight) {
+        first.resize(dst);
+        last.resize(dst);
+        weight.resize(dst);
+        for (int i = 0; i < dst; ++i) {
+            if (src >= dst) {
+                // Box filter footprint, at least one sample
+                first[i] = int(int64_t(i) * src / dst);
+                last[i] = std::max(first[i] + 1, int(int64_t(i + 1) * src / dst));
+                weight[i] = 0;
+            } else {
+                // Bilinear taps with 8 bit weight of the second tap
+                float pos = std::max(0.0f, (i + 0.5f) * src / dst - 0.5f);
+                first[i] = std::min(int(pos), src - 1);
+                last[i] = std::min(first[i] + 1, src - 1);
+                weight[i] = int((pos - first[i]) * 256.0f);
+            }
+        }
+    };
+    build(ssaa_width, width, resolve_x0, resolve_x1, resolve_wx);
+    build(ssaa_height, height, resolve_y0, resolve_y1, resolve_wy);
+}
 
-    return;
+// Build offset tables of the render target, returns samples it spans
+int Renderer::update_layout(int target_width, int target_height) {
+    row_offset.resize(target_height);
+    col_offset.resize(target_width);
+
+    if (!tiled) {
+        for (int y = 0; y < target_height; ++y) row_offset[y] = y * target_width;
+        for (int x = 0; x < target_width; ++x) col_offset[x] = x;
+        return target_width * target_height;
+    }
+
+    // Morton index inside a tile interleaves x into even and y into odd bits,
+    // so it splits into a row and a column part
+    auto spread = [](int v) { return (v & 1) | ((v & 2) << 1) | ((v & 4) << 2); };
+    const int tile_samples = TILE_SIZE * TILE_SIZE;
+    int tiles_x = (target_width + TILE_SIZE - 1) / TILE_SIZE;
+    int tiles_y = (target_height + TILE_SIZE - 1) / TILE_SIZE;
+    for (int y = 0; y < target_height; ++y) {
+        row_offset[y] = (y / TILE_SIZE) * tiles_x * tile_samples + (spread(y % TILE_SIZE) << 1);
+    }
+    for (int x = 0; x < target_width; ++x) {
+        col_offset[x] = (x / TILE_SIZE) * tile_samples + spread(x % TILE_SIZE);
+    }
+    return tiles_x * tiles_y * tile_samples;
 }
 
-// Disable SSAA
-void Renderer::disable_ssaa() {
-    enable_ssaa(0);
-    return;
+// Grow sample buffers to hold at least samples entries
+void Renderer::reserve_samples(int samples) {
+    if (samples > ssaa_capacity) {
+        delete[] ssaa_buffer;
+        ssaa_buffer = new uint32_t[samples];
+        ssaa_capacity = samples;
+    }
+    reserve_depth(samples);
+}
+
+// Grow depth and visibility buffers to hold at least samples entries
+void Renderer::reserve_depth(int samples) {
+    if ((int)zbuffer.size() < samples) zbuffer.resize(samples, std::numeric_limits<float>::infinity());
+    if (visibility && (int)id_buffer.size() < samples) id_buffer.resize(samples, 0);
+    if (overdraw.is_enabled()) overdraw.reserve(size_t(samples));
 }
 
 
@@ -86,104 +194,997 @@ Vec3 Renderer::project_vertex(const Vec3& vertex, const Mat4& model_matrix) cons
 
 // Render wireframe
 void Renderer::render_wireframe(const Renderable& obj) {
-    const auto& verts = obj.get_vertices();
-    const auto& inds = obj.get_indices();
-    Mat4 model = obj.get_model_matrix();
-
-    // Transform all vertices from model space to screen space
-    std::vector<Vec3> projectedVerts;
-    projectedVerts.reserve(verts.size());
-    for (const auto& v : verts) {
-        projectedVerts.push_back(project_vertex(v, model));
-    }
-
-    int screen_width = ssaa ? ssaa_width : width;
-    int screen_height = ssaa ? ssaa_height : height;
-
-    // Draw edges by connecting indices pairs
-    for (size_t i = 0; i + 2 < inds.size(); i += 3) {
-        Vec4 v0 = model_to_clip(verts[inds[i]], model);
-        Vec4 v1 = model_to_clip(verts[inds[i + 1]], model);
-        Vec4 v2 = model_to_clip(verts[inds[i + 2]], model);
-
-        auto clipped = clip_triangle({v0, v1, v2});
-        for (auto& triangle : clipped) {
-            // Perform perspective division
-            Vec3 p0 = triangle[0].homo();
-            Vec3 p1 = triangle[1].homo();
-            Vec3 p2 = triangle[2].homo();  
-
-            // Check for degenerate triangle (area close to zero)
-            Vec3 edge1 = p1 - p0;
-            Vec3 edge2 = p2 - p0;
-            float area = edge1.x * edge2.y - edge1.y * edge2.x;
-            if(fabs(area) < 1e-6f) {
-                continue;
+    render_wireframe(obj, obj.get_model_matrix());
+}
+
+// Render wireframe with a model matrix overriding the object's own
+void Renderer::render_wireframe(const Renderable& obj, const Mat4& model) {
+    single_item.clear();
+    single_item.push_back({&obj, model, Render_mode::Wireframe, shade_mode});
+    render_batch(single_item);
+}
+
+// Render multiple wireframes
+void Renderer::render_wireframes() {
+    scene_items.clear();
+    for (auto* obj : objects) {
+        scene_items.push_back({obj, obj->get_model_matrix(), Render_mode::Wireframe, shade_mode});
+    }
+    render_batch(scene_items);
+}
+
+// Unpack ARGB color to 0-255 channels
+static Vec3 unpack_color(uint32_t color) {
+    return Vec3(float((color >> 16) & 0xFF), float((color >> 8) & 0xFF), float(color & 0xFF));
+}
+
+// Pack 0-255 channels to opaque ARGB color
+static uint32_t pack_color(float r, float g, float b) {
+    uint32_t ri = uint32_t(std::min(std::max(r, 0.0f), 255.0f));
+    uint32_t gi = uint32_t(std::min(std::max(g, 0.0f), 255.0f));
+    uint32_t bi = uint32_t(std::min(std::max(b, 0.0f), 255.0f));
+    return 0xFF000000 | (ri << 16) | (gi << 8) | bi;
+}
+
+// Pack 0-255 channels modulated by a texel to opaque ARGB color
+static uint32_t modulate_color(uint32_t texel, float r, float g, float b) {
+    const float scale = 1.0f / 255.0f;
+    return pack_color(r * float((texel >> 16) & 0xFF) * scale, g * float((texel >> 8) & 0xFF) * scale,
+                      b * float(texel & 0xFF) * scale);
+}
+
+// Mip level for a convex polygon of raster vertices, from the texels its
+// texture coordinates span and the samples it covers
+static int texture_level(const Texture& texture, const Renderer::Raster_vertex* poly, size_t count) {
+    float sample_area = 0.0f, uv_area = 0.0f;
+    for (size_t i = 0, j = count - 1; i < count; j = i++) {
+        sample_area += poly[j].x * poly[i].y - poly[i].x * poly[j].y;
+        uv_area += poly[j].u * poly[i].v - poly[i].u * poly[j].v;
+    }
+    float texel_area = std::fabs(uv_area) * float(texture.get_width()) * float(texture.get_height());
+    return texture.select_level(texel_area, std::fabs(sample_area));
+}
+
+// Render filled object
+void Renderer::render_filled(const Renderable& obj) {
+    render_filled(obj, obj.get_model_matrix());
+}
+
+// Render filled object with a model matrix overriding the object's own
+void Renderer::render_filled(const Renderable& obj, const Mat4& model) {
+    single_item.clear();
+    single_item.push_back({&obj, model, Render_mode::Filled, shade_mode});
+    render_batch(single_item);
+}
+
+// Render all objects in the current render mode
+void Renderer::render() {
+    scene_items.clear();
+    for (auto* obj : objects) {
+        scene_items.push_back({obj, obj->get_model_matrix(), render_mode, shade_mode});
+    }
+
+    if (dirty_regions) update_damage(scene_items);
+    scene_batch = true;
+    render_batch(scene_items);
+    scene_batch = false;
+
+    // The next frame can be drawn partially if this scene is all the target holds
+    if (dirty_regions) {
+        std::swap(last_scene, next_scene);
+        last_view_projection = projection * view;
+        scene_valid = frame_batches == 1 && !visibility && !occlusion && views.empty() && !overdraw.is_enabled();
+    }
+}
+
+// Set job system running the geometry stage, null runs it on the calling thread
+void Renderer::set_job_system(Job_system* _jobs) {
+    jobs = _jobs;
+}
+
+// Run count jobs on the job system or inline
+void Renderer::run_jobs(size_t count, const Job_system::Job& job) {
+    if (jobs) {
+        jobs->parallel_for(count, job);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) job(i, 0);
+}
+
+// Flush a clear deferred by dirty regions and count the batch
+void Renderer::begin_batch() {
+    // Draws other than the scene of render() aren't tracked by dirty regions
+    if (clear_pending) clear_target();
+    if (!scene_batch) scene_valid = false;
+    frame_batches++;
+}
+
+// Vertex count of float or quantized storage
+static size_t vertex_count(const Renderable& obj) {
+    const Quantized_mesh* quantized = obj.get_quantized();
+    return quantized ? quantized->get_vertex_count() : obj.get_vertices().size();
+}
+
+// Index count of float or quantized storage
+static size_t index_count(const Renderable& obj) {
+    const Quantized_mesh* quantized = obj.get_quantized();
+    return quantized ? quantized->get_index_count() : obj.get_indices().size();
+}
+
+// Render a batch of objects. Vertices and triangles are split into fixed size
+// chunks that run on the job system, rasterization consumes the chunk outputs
+// in submission order so the image doesn't depend on thread count or timing.
+void Renderer::render_batch(const std::vector<Draw_item>& items) {
+    begin_batch();
+    if (items.empty()) return;
+
+    // Without views the single camera covers the whole target
+    size_t view_count = std::max<size_t>(1, views.size());
+    bool multi_view = view_count > 1;
+    batch_visibility = visibility && !multi_view;
+
+    auto view_projection = [this](size_t v) {
+        return views.empty() ? projection * view : views[v].projection * views[v].view;
+    };
+
+    // Per object setup, global vertex offsets and chunk lists
+    batch_objects.resize(items.size());
+    vertex_chunks.clear();
+    triangle_chunks.clear();
+    size_t vertex_total = batch_visibility ? vis_clip_verts.size() : 0;
+
+    // Objects outside the union of the view frustums are dropped before any vertex work
+    for (size_t i = 0; i < items.size(); ++i) {
+        Batch_object& b = batch_objects[i];
+        b.item = &items[i];
+        b.culled = true;
+        b.outside = false;
+
+        Aabb bounds = items[i].obj->get_bounds();
+        for (size_t v = 0; v < view_count && b.culled; ++v) {
+            b.mvp = view_projection(v) * items[i].model;
+            b.culled = outside_frustum(bounds, b.mvp);
+        }
+        if (b.culled) PROFILE_COUNT(profiler, Counter::Objects_outside, 1);
+    }
+
+    // A partial frame only draws objects overlapping the damage
+    if (partial) {
+        for (size_t i = 0; i < items.size(); ++i) {
+            Batch_object& b = batch_objects[i];
+            const Rect& r = next_scene[i].bounds;
+            b.culled = b.culled || std::none_of(damage.begin(), damage.end(), [&r](const Rect& d) {
+                return r.x0 < d.x1 && d.x0 < r.x1 && r.y0 < d.y1 && d.y0 < r.y1;
+            });
+        }
+    }
+
+    // Occluders first, then every other object is tested before any vertex work
+    if (occlusion && !multi_view) {
+        PROFILE_SCOPE(profiler, Stage::Occlusion);
+        for (const Batch_object& b : batch_objects) {
+            if (!b.culled && b.item->obj->is_occluder()) rasterize_occluder(*b.item->obj, b.mvp);
+        }
+        for (Batch_object& b : batch_objects) {
+            if (b.culled || b.item->obj->is_occluder()) continue;
+            b.culled = occluded(b.item->obj->get_bounds(), b.mvp);
+            if (b.culled) PROFILE_COUNT(profiler, Counter::Objects_occluded, 1);
+        }
+    }
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        const Draw_item& item = items[i];
+        Batch_object& b = batch_objects[i];
+        if (b.culled) continue;
+
+        size_t vertex_count = ::vertex_count(*item.obj);
+        size_t triangle_count = index_count(*item.obj) / 3;
+
+        b.normal_matrix = item.model.normal_matrix();
+        b.gouraud = item.shade == Shade_mode::Gouraud && item.obj->get_normals().size() == vertex_count;
+        const Texture* texture = item.obj->get_texture();
+        bool textured = item.mode == Render_mode::Filled && texture && texture->get_level_count() > 0 &&
+                        item.obj->get_uvs().size() == vertex_count;
+        b.texture = textured ? texture : nullptr;
+        b.vertex_offset = vertex_total;
+        b.base_id = 0;
+        vertex_total += vertex_count;
+
+        // Visibility buffer keeps the vertex stage output until the frame is shaded
+        if (batch_visibility && item.mode == Render_mode::Filled) {
+            b.base_id = vis_next_id;
+            vis_objects.push_back({item.obj, b.base_id, b.vertex_offset, b.normal_matrix, b.gouraud, b.texture});
+            vis_next_id += uint32_t(triangle_count);
+        }
+
+        for (size_t v = 0; v < vertex_count; v += VERTEX_CHUNK) {
+            vertex_chunks.push_back({i, v, std::min(v + VERTEX_CHUNK, vertex_count)});
+        }
+        for (size_t t = 0; t < triangle_count; t += TRIANGLE_CHUNK) {
+            triangle_chunks.push_back({i, t, std::min(t + TRIANGLE_CHUNK, triangle_count)});
+        }
+    }
+
+    if (batch_visibility) {
+        vis_clip_verts.resize(vertex_total);
+        vis_colors.resize(vertex_total);
+        batch_clip = vis_clip_verts.data();
+        batch_colors = vis_colors.data();
+    } else {
+        clip_verts.resize(vertex_total);
+        vert_colors.resize(vertex_total);
+        batch_clip = clip_verts.data();
+        batch_colors = vert_colors.data();
+    }
+    clip_codes.resize(vertex_total);
+
+    // Lighting is view independent, with several views it runs once up front
+    if (multi_view) {
+        PROFILE_SCOPE(profiler, Stage::Transform);
+        run_jobs(vertex_chunks.size(), [this](size_t c, unsigned) {
+            process_vertices(vertex_chunks[c], false, true);
+        });
+    }
+
+    for (size_t v = 0; v < view_count; ++v) {
+        if (multi_view) {
+            viewport = target_viewport(views[v]);
+            scissor = viewport;
+            Mat4 vp = view_projection(v);
+            for (Batch_object& b : batch_objects) {
+                if (b.culled) continue;
+                b.mvp = vp * b.item->model;
+                b.outside = outside_frustum(b.item->obj->get_bounds(), b.mvp);
             }
+        } else if (!views.empty()) {
+            viewport = target_viewport(views[0]);
+            scissor = viewport;
+        }
 
-            // Convert to screen space
-            auto to_screen = [screen_width, screen_height](const Vec3& ndc) {
-                return Vec3(
-                    (ndc.x + 1.0f) * 0.5f * screen_width,
-                    (1.0f - ndc.y) * 0.5f * screen_height,
-                    ndc.z
-                );
-            };
+        // Vertex stage, every vertex is transformed once per view
+        {
+            PROFILE_SCOPE(profiler, Stage::Transform);
+            run_jobs(vertex_chunks.size(), [this, multi_view](size_t c, unsigned) {
+                process_vertices(vertex_chunks[c], true, !multi_view);
+            });
+        }
 
-            Vec3 s0 = to_screen(p0);
-            Vec3 s1 = to_screen(p1);
-            Vec3 s2 = to_screen(p2);
+        // Triangle stage runs in waves of chunks to bound the queued primitives
+        size_t wave = jobs ? size_t(jobs->get_worker_count()) * 4 : 1;
+        if (chunk_outputs.size() < wave) chunk_outputs.resize(wave);
+        if (chunk_counts.size() < wave) chunk_counts.resize(wave);
+
+        for (size_t start = 0; start < triangle_chunks.size(); start += wave) {
+            size_t count = std::min(wave, triangle_chunks.size() - start);
+
+            {
+                PROFILE_SCOPE(profiler, Stage::Clip);
+                run_jobs(count, [this, start](size_t k, unsigned) {
+                    chunk_outputs[k].clear();
+                    chunk_counts[k] = Chunk_counts();
+                    process_triangles(triangle_chunks[start + k], chunk_outputs[k], chunk_counts[k]);
+                });
+            }
 
-            draw_line(s0, s1, 0xFFFFFFFF);
-            draw_line(s1, s2, 0xFF00FFFF);
-            draw_line(s2, s0, 0xFFFF00FF);
+            for (size_t k = 0; k < count; ++k) {
+                PROFILE_COUNT(profiler, Counter::Triangles_submitted, chunk_counts[k].submitted);
+                PROFILE_COUNT(profiler, Counter::Triangles_rejected, chunk_counts[k].rejected);
+                PROFILE_COUNT(profiler, Counter::Triangles_clipped, chunk_counts[k].clipped);
+                PROFILE_COUNT(profiler, Counter::Triangles_degenerate, chunk_counts[k].degenerate);
+            }
+
+            // Damaged rects are disjoint, drawing each clipped to its rect writes
+            // every sample in the same order as drawing the whole target
+            PROFILE_SCOPE(profiler, Stage::Raster);
+            size_t passes = partial ? damage.size() : 1;
+            for (size_t pass = 0; pass < passes; ++pass) {
+                if (partial) scissor = damage[pass];
+                for (size_t k = 0; k < count; ++k) {
+                    for (const Screen_triangle& t : chunk_outputs[k]) {
+                        if (partial) {
+                            const Rect& r = next_scene[t.item].bounds;
+                            if (r.x0 >= scissor.x1 || scissor.x0 >= r.x1 || r.y0 >= scissor.y1 || scissor.y0 >= r.y1) continue;
+                        }
+                        if (items[t.item].mode == Render_mode::Wireframe) {
+                            Vec3 s0(t.v[0].x, t.v[0].y, t.v[0].z);
+                            Vec3 s1(t.v[1].x, t.v[1].y, t.v[1].z);
+                            Vec3 s2(t.v[2].x, t.v[2].y, t.v[2].z);
+                            draw_line(s0, s1, 0xFFFFFFFF);
+                            draw_line(s1, s2, 0xFF00FFFF);
+                            draw_line(s2, s0, 0xFFFF00FF);
+                        } else if (batch_visibility) {
+                            draw_triangle_id(t.v[0], t.v[1], t.v[2], t.id);
+                        } else {
+                            draw_triangle(t.v[0], t.v[1], t.v[2], batch_objects[t.item].texture, t.level);
+                        }
+                    }
+                }
+            }
         }
     }
 
+    // Direct drawing outside batches uses the whole target
+    viewport = {0, 0, ssaa ? ssaa_width : width, ssaa ? ssaa_height : height};
+    scissor = viewport;
 }
 
-// Render multiple wireframes
-void Renderer::render_wireframes() {
-    for (auto* obj : objects) {
-        render_wireframe(*obj);
+// Draw a point cloud as depth tested splats. Every chunk reduces its points into
+// per sample keys with an atomic min, keys are merged into the target once all
+// chunks of a view ran.
+void Renderer::render_points(const Point_cloud& cloud) {
+    begin_batch();
+    size_t count = cloud.get_point_count();
+    if (count == 0) return;
+
+    int target_width = ssaa ? ssaa_width : width;
+    int target_height = ssaa ? ssaa_height : height;
+    size_t samples = size_t(ssaa ? ssaa_size : size);
+    if (point_capacity < samples) {
+        point_keys.reset(new std::atomic<uint64_t>[samples]);
+        for (size_t i = 0; i < samples; ++i) point_keys[i].store(NO_POINT, std::memory_order_relaxed);
+        point_capacity = samples;
+    }
+
+    // Point size is given in window pixels
+    int splat = std::max(1, int(std::lround(cloud.get_point_size() * target_width / width)));
+    point_chunks.resize((count + POINT_CHUNK - 1) / POINT_CHUNK);
+
+    size_t view_count = std::max<size_t>(1, views.size());
+    for (size_t v = 0; v < view_count; ++v) {
+        Mat4 mvp = views.empty() ? projection * view * cloud.get_model_matrix()
+                                 : views[v].projection * views[v].view * cloud.get_model_matrix();
+        viewport = views.empty() ? Rect{0, 0, target_width, target_height} : target_viewport(views[v]);
+        if (outside_frustum(cloud.get_bounds(), mvp)) {
+            PROFILE_COUNT(profiler, Counter::Points_submitted, count);
+            PROFILE_COUNT(profiler, Counter::Points_rejected, count);
+            continue;
+        }
+
+        PROFILE_SCOPE(profiler, Stage::Raster);
+        run_jobs(point_chunks.size(), [this, &cloud, &mvp, splat, count](size_t c, unsigned) {
+            splat_points(cloud, mvp, splat, c * POINT_CHUNK, std::min(count, (c + 1) * POINT_CHUNK), point_chunks[c]);
+        });
+
+        // Only the samples some chunk wrote are merged
+        Rect touched = {target_width, target_height, 0, 0};
+        for (const Point_chunk& chunk : point_chunks) {
+            PROFILE_COUNT(profiler, Counter::Points_submitted, chunk.submitted);
+            PROFILE_COUNT(profiler, Counter::Points_rejected, chunk.rejected);
+            touched.x0 = std::min(touched.x0, chunk.touched.x0);
+            touched.y0 = std::min(touched.y0, chunk.touched.y0);
+            touched.x1 = std::max(touched.x1, chunk.touched.x1);
+            touched.y1 = std::max(touched.y1, chunk.touched.y1);
+        }
+        if (touched.x0 < touched.x1 && touched.y0 < touched.y1) merge_points(touched);
     }
+
+    viewport = {0, 0, target_width, target_height};
 }
 
-void Renderer::render_filled(const Renderable& obj) {
-    
+// Transform, frustum test and splat a range of points. Depth in [0, 1] keeps
+// its order as integer bits, so the nearest point has the smallest key.
+void Renderer::splat_points(const Point_cloud& cloud, const Mat4& mvp, int splat, size_t begin, size_t end,
+                            Point_chunk& chunk) const {
+    const Vec3* positions = cloud.get_positions().data();
+    const uint32_t* colors = cloud.get_colors().empty() ? nullptr : cloud.get_colors().data();
+    uint32_t color = cloud.get_color();
+
+    const float vx = float(viewport.x0), vy = float(viewport.y0);
+    const float vw = float(viewport.x1 - viewport.x0), vh = float(viewport.y1 - viewport.y0);
+    const int before = (splat - 1) / 2, after = splat / 2;
+
+    // Matrix rows in locals, the atomic writes below would force reloads
+    const float m00 = mvp.m[0][0], m01 = mvp.m[0][1], m02 = mvp.m[0][2], m03 = mvp.m[0][3];
+    const float m10 = mvp.m[1][0], m11 = mvp.m[1][1], m12 = mvp.m[1][2], m13 = mvp.m[1][3];
+    const float m20 = mvp.m[2][0], m21 = mvp.m[2][1], m22 = mvp.m[2][2], m23 = mvp.m[2][3];
+    const float m30 = mvp.m[3][0], m31 = mvp.m[3][1], m32 = mvp.m[3][2], m33 = mvp.m[3][3];
+    const int* rows = row_offset.data();
+    const int* cols = col_offset.data();
+    std::atomic<uint64_t>* keys = point_keys.get();
+
+    // Keep the nearest key of a sample
+    auto write = [keys](int index, uint64_t key) {
+        std::atomic<uint64_t>& target = keys[index];
+        uint64_t current = target.load(std::memory_order_relaxed);
+        while (key < current && !target.compare_exchange_weak(current, key, std::memory_order_relaxed)) {}
+    };
+
+    int min_x = viewport.x1, min_y = viewport.y1, max_x = viewport.x0 - 1, max_y = viewport.y0 - 1;
+    uint64_t rejected = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const Vec3& p = positions[i];
+        float w = m30 * p.x + m31 * p.y + m32 * p.z + m33;
+        float cx = m00 * p.x + m01 * p.y + m02 * p.z + m03;
+        float cy = m10 * p.x + m11 * p.y + m12 * p.z + m13;
+        float cz = m20 * p.x + m21 * p.y + m22 * p.z + m23;
+        if (!(w > 0.0f && std::fabs(cx) <= w && std::fabs(cy) <= w && std::fabs(cz) <= w)) {
+            rejected++;
+            continue;
+        }
+
+        float inv_w = 1.0f / w;
+        int px = std::min(int(vx + (cx * inv_w + 1.0f) * 0.5f * vw), viewport.x1 - 1);
+        int py = std::min(int(vy + (1.0f - cy * inv_w) * 0.5f * vh), viewport.y1 - 1);
+        float z = (cz * inv_w + 1.0f) * 0.5f;
+
+        uint32_t depth_bits;
+        std::memcpy(&depth_bits, &z, sizeof(depth_bits));
+        uint64_t key = uint64_t(depth_bits) << 32 | (colors ? colors[i] : color);
+
+        int x0 = px, x1 = px, y0 = py, y1 = py;
+        if (splat == 1) {
+            write(rows[py] + cols[px], key);
+        } else {
+            x0 = std::max(px - before, viewport.x0);
+            x1 = std::min(px + after, viewport.x1 - 1);
+            y0 = std::max(py - before, viewport.y0);
+            y1 = std::min(py + after, viewport.y1 - 1);
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) write(rows[y] + cols[x], key);
+            }
+        }
+        min_x = std::min(min_x, x0);
+        min_y = std::min(min_y, y0);
+        max_x = std::max(max_x, x1);
+        max_y = std::max(max_y, y1);
+    }
+
+    chunk.touched = {min_x, min_y, max_x + 1, max_y + 1};
+    chunk.submitted = end - begin;
+    chunk.rejected = rejected;
+}
+
+// Depth test the keys of rect against the target like put_pixel and reset them
+void Renderer::merge_points(const Rect& rect) {
+    uint32_t* target = ssaa ? ssaa_buffer : framebuffer;
+    for (int y = rect.y0; y < rect.y1; ++y) {
+        const int row = row_offset[y];
+        for (int x = rect.x0; x < rect.x1; ++x) {
+            int index = row + col_offset[x];
+            uint64_t key = point_keys[index].load(std::memory_order_relaxed);
+            if (key == NO_POINT) continue;
+            point_keys[index].store(NO_POINT, std::memory_order_relaxed);
+
+            uint32_t depth_bits = uint32_t(key >> 32);
+            float z;
+            std::memcpy(&z, &depth_bits, sizeof(z));
+            if (z < zbuffer[index]) {
+                zbuffer[index] = z;
+                target[index] = uint32_t(key);
+                if (visibility) id_buffer[index] = 0;
+                PROFILE_COUNT(profiler, Counter::Depth_pass, 1);
+                OVERDRAW_COUNT(overdraw, index, true);
+                PROFILE_COUNT(profiler, Counter::Pixels_drawn, 1);
+            } else {
+                PROFILE_COUNT(profiler, Counter::Depth_fail, 1);
+                OVERDRAW_COUNT(overdraw, index, false);
+            }
+        }
+    }
+}
+
+// Target samples the projected bounds can touch, padded for line rounding and AA coverage
+Renderer::Rect Renderer::screen_bounds(const Aabb& bounds, const Mat4& mvp) const {
+    int target_width = ssaa ? ssaa_width : width;
+    int target_height = ssaa ? ssaa_height : height;
+    if (bounds.empty()) return {0, 0, 0, 0};
+
+    float min_x = 1.0f, min_y = 1.0f, max_x = -1.0f, max_y = -1.0f;
+    for (int i = 0; i < 8; ++i) {
+        Vec3 p = bounds.corner(i);
+        Vec4 clip = mvp.transform(Vec4(p.x, p.y, p.z, 1.0f));
+        if (clip.w <= 1e-6f) return {0, 0, target_width, target_height};
+        float x = clip.x / clip.w, y = clip.y / clip.w;
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+    }
+
+    // Same mapping as process_triangles, y flips
+    const int pad = 2;
+    Rect rect;
+    rect.x0 = int(std::floor((std::max(min_x, -1.0f) + 1.0f) * 0.5f * target_width)) - pad;
+    rect.x1 = int(std::ceil((std::min(max_x, 1.0f) + 1.0f) * 0.5f * target_width)) + pad;
+    rect.y0 = int(std::floor((1.0f - std::min(max_y, 1.0f)) * 0.5f * target_height)) - pad;
+    rect.y1 = int(std::ceil((1.0f - std::max(min_y, -1.0f)) * 0.5f * target_height)) + pad;
+    rect.x0 = std::max(rect.x0, 0);
+    rect.y0 = std::max(rect.y0, 0);
+    rect.x1 = std::min(rect.x1, target_width);
+    rect.y1 = std::min(rect.y1, target_height);
+    if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1) return {0, 0, 0, 0};
+    return rect;
+}
+
+// Compare the scene with the last frame, a partial frame clears only the damaged rects
+void Renderer::update_damage(const std::vector<Draw_item>& items) {
+    Mat4 view_projection = projection * view;
+    partial = clear_pending && scene_valid && frame_batches == 0 && !visibility && !occlusion && views.empty() &&
+              !overdraw.is_enabled() &&
+              std::memcmp(&view_projection, &last_view_projection, sizeof(Mat4)) == 0;
+
+    next_scene.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        const Renderable& obj = *items[i].obj;
+        Scene_state& state = next_scene[i];
+        state.obj = &obj;
+        state.model = items[i].model;
+        state.mode = items[i].mode;
+        state.shade = items[i].shade;
+        state.color = obj.get_color();
+        state.texture = obj.get_texture();
+        const Quantized_mesh* quantized = obj.get_quantized();
+        state.mesh = quantized ? static_cast<const void*>(quantized) : obj.get_vertices().data();
+        state.vertex_count = vertex_count(obj);
+        state.bounds = screen_bounds(obj.get_bounds(), view_projection * items[i].model);
+    }
+    if (!partial) return;
+
+    // Objects that changed damage where they were and where they are, objects
+    // that came or went damage their one rect
+    damage.clear();
+    size_t common = std::min(last_scene.size(), next_scene.size());
+    for (size_t i = 0; i < std::max(last_scene.size(), next_scene.size()); ++i) {
+        if (i < common) {
+            const Scene_state& a = last_scene[i];
+            const Scene_state& b = next_scene[i];
+            if (a.obj == b.obj && a.mode == b.mode && a.shade == b.shade && a.color == b.color && a.texture == b.texture &&
+                a.mesh == b.mesh && a.vertex_count == b.vertex_count &&
+                std::memcmp(&a.model, &b.model, sizeof(Mat4)) == 0) continue;
+        }
+        if (i < last_scene.size()) add_damage(last_scene[i].bounds);
+        if (i < next_scene.size()) add_damage(next_scene[i].bounds);
+    }
+
+    // Large damage is cheaper to redraw and present as one frame
+    int target_width = ssaa ? ssaa_width : width;
+    int target_height = ssaa ? ssaa_height : height;
+    int64_t area = 0;
+    for (const Rect& r : damage) area += int64_t(r.x1 - r.x0) * (r.y1 - r.y0);
+    if (area * 2 > int64_t(target_width) * target_height) {
+        partial = false;
+        return;
+    }
+
+    PROFILE_SCOPE(profiler, Stage::Clear);
+    PROFILE_COUNT(profiler, Counter::Pixels_damaged, uint64_t(area));
+    uint32_t* target = ssaa ? ssaa_buffer : framebuffer;
+    present_rects.clear();
+    for (const Rect& r : damage) {
+        for (int y = r.y0; y < r.y1; ++y) {
+            const int row = row_offset[y];
+            for (int x = r.x0; x < r.x1; ++x) {
+                int index = row + col_offset[x];
+                target[index] = clear_color;
+                zbuffer[index] = std::numeric_limits<float>::infinity();
+            }
+        }
+        present_rects.push_back(window_rect(r));
+    }
+    clear_pending = false;
+}
+
+// Add a rect to damage, merging it with the rects it overlaps so damage stays disjoint
+void Renderer::add_damage(Rect rect) {
+    if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1) return;
+
+    for (size_t i = 0; i < damage.size();) {
+        const Rect& d = damage[i];
+        if (rect.x0 < d.x1 && d.x0 < rect.x1 && rect.y0 < d.y1 && d.y0 < rect.y1) {
+            rect = {std::min(rect.x0, d.x0), std::min(rect.y0, d.y0), std::max(rect.x1, d.x1), std::max(rect.y1, d.y1)};
+            damage.erase(damage.begin() + i);
+            i = 0; // The grown rect can overlap rects checked before
+        } else {
+            ++i;
+        }
+    }
+    damage.push_back(rect);
+
+    if (damage.size() > MAX_DAMAGE_RECTS) {
+        Rect bounds = damage[0];
+        for (const Rect& d : damage) {
+            bounds = {std::min(bounds.x0, d.x0), std::min(bounds.y0, d.y0), std::max(bounds.x1, d.x1), std::max(bounds.y1, d.y1)};
+        }
+        damage.assign(1, bounds);
+    }
+}
+
+// Window pixels whose resolve reads samples of a target rect
+Renderer::Rect Renderer::window_rect(const Rect& target) const {
+    if (!ssaa) return target;
+
+    // Box footprints end exclusive, bilinear taps inclusive
+    auto range = [](const std::vector<int>& first, const std::vector<int>& last, bool box, int t0, int t1, int& w0, int& w1) {
+        int n = int(first.size());
+        w0 = 0;
+        while (w0 < n && (box ? last[w0] <= t0 : last[w0] < t0)) w0++;
+        w1 = w0;
+        while (w1 < n && first[w1] < t1) w1++;
+    };
+
+    Rect rect;
+    range(resolve_x0, resolve_x1, ssaa_width >= width, target.x0, target.x1, rect.x0, rect.x1);
+    range(resolve_y0, resolve_y1, ssaa_height >= height, target.y0, target.y1, rect.y0, rect.y1);
+    return rect;
+}
+
+// Transform and outcode a range of vertices of one object for the current view,
+// light them if colors is set
+void Renderer::process_vertices(const Vertex_chunk& chunk, bool positions, bool colors) {
+    const Batch_object& b = batch_objects[chunk.object];
+    if (positions && b.outside) return;
+
+    const Renderable& obj = *b.item->obj;
+    const Quantized_mesh* quantized = obj.get_quantized();
+    const auto& verts = obj.get_vertices();
+    const auto& normals = obj.get_normals();
+    const auto& vertex_color = obj.get_colors();
+
+    bool filled = b.item->mode == Render_mode::Filled;
+    bool vertex_colors = vertex_color.size() == ::vertex_count(obj);
+    Vec3 base_color = unpack_color(obj.get_color());
+    Vec3 to_light = light_dir * -1.0f;
+
+    Vec4* out_clip = batch_clip + b.vertex_offset;
+    Vec3* out_colors = batch_colors + b.vertex_offset;
+    int* out_codes = clip_codes.data() + b.vertex_offset;
+
+    // Packed positions go through the transform with the dequantization folded in
+    Mat4 packed_mvp = quantized ? b.mvp * quantized->get_dequantize() : b.mvp;
+    const Vec3_u16* packed = quantized ? quantized->get_positions().data() : nullptr;
+
+    for (size_t i = chunk.begin; i < chunk.end; ++i) {
+        if (positions) {
+            if (packed) out_clip[i] = packed_mvp.transform(packed[i]);
+            else out_clip[i] = b.mvp.transform(Vec4(verts[i].x, verts[i].y, verts[i].z, 1.0f));
+            out_codes[i] = outcode(out_clip[i]);
+        }
+        if (!filled || !colors) continue;
+
+        Vec3 color = vertex_colors ? unpack_color(vertex_color[i]) : base_color;
+        if (b.gouraud) {
+            Vec3 n = b.normal_matrix.transform_dir(normals[i]).norm();
+            color = color * (ambient + (1.0f - ambient) * std::max(0.0f, n.dot(to_light)));
+        }
+        out_colors[i] = color;
+    }
+}
+
+// Cull, clip and map a range of triangles of one object to screen space
+void Renderer::process_triangles(const Triangle_chunk& chunk, std::vector<Screen_triangle>& out,
+                                 Chunk_counts& counts) const {
+    const Batch_object& b = batch_objects[chunk.object];
+    if (b.outside) return;
+    const Renderable& obj = *b.item->obj;
+    const Quantized_mesh* quantized = obj.get_quantized();
+    const auto& verts = obj.get_vertices();
+    const uint32_t* inds = obj.get_indices().data();
+
+    // Quantized indices are walked cluster by cluster, chunks may span several
+    const Quantized_mesh::Cluster* cluster = quantized ? &quantized->find_cluster(chunk.begin * 3) : nullptr;
+
+    bool filled = b.item->mode == Render_mode::Filled;
+    bool flat = filled && !b.gouraud && !batch_visibility;
+    Vec3 to_light = light_dir * -1.0f;
+
+    // Face normals of quantized meshes are taken from packed positions, the
+    // dequantization moves into their normal matrix
+    Mat4 face_matrix = b.normal_matrix;
+    if (flat && quantized) face_matrix = (b.item->model * quantized->get_dequantize()).normal_matrix();
+    const Vec3_u16* packed = quantized ? quantized->get_positions().data() : nullptr;
+
+    const Vec4* in_clip = batch_clip + b.vertex_offset;
+    const Vec3* in_colors = batch_colors + b.vertex_offset;
+    const int* in_codes = clip_codes.data() + b.vertex_offset;
+
+    // Texture coordinates are interpolated like colors, a mip level is picked per triangle
+    const Texture* texture = b.texture;
+    const Vec2* uvs = texture ? obj.get_uvs().data() : nullptr;
+
+    float screen_x = float(viewport.x0), screen_y = float(viewport.y0);
+    int screen_width = viewport.x1 - viewport.x0;
+    int screen_height = viewport.y1 - viewport.y0;
+
+    // Perspective divide and viewport mapping of a clip space vertex
+    auto to_raster = [screen_x, screen_y, screen_width, screen_height](const Vec4& clip, const Vec3& color, const Vec2& uv) {
+        float inv_w = 1.0f / clip.w;
+        Raster_vertex v;
+        v.x = screen_x + (clip.x * inv_w + 1.0f) * 0.5f * screen_width;
+        v.y = screen_y + (1.0f - clip.y * inv_w) * 0.5f * screen_height;
+        v.z = (clip.z * inv_w + 1.0f) * 0.5f;
+        v.inv_w = inv_w;
+        v.r = color.x;
+        v.g = color.y;
+        v.b = color.z;
+        v.u = uv.x;
+        v.v = uv.y;
+        return v;
+    };
+
+    // Degenerate test on normalized device coordinates
+    auto degenerate = [screen_width, screen_height](const Raster_vertex& a, const Raster_vertex& b, const Raster_vertex& c) {
+        float sx = 2.0f / screen_width, sy = 2.0f / screen_height;
+        float area = ((b.x - a.x) * sx) * ((c.y - a.y) * sy) - ((b.y - a.y) * sy) * ((c.x - a.x) * sx);
+        return std::fabs(area) < 1e-6f;
+    };
+
+    // Wireframe edges divide and test area in normalized device coordinates
+    auto to_lines = [screen_x, screen_y, screen_width, screen_height](const Vec4& a, const Vec4& b, const Vec4& c,
+                                                                     Screen_triangle& t) {
+        Vec3 p[3] = {a.homo(), b.homo(), c.homo()};
+        Vec3 edge1 = p[1] - p[0];
+        Vec3 edge2 = p[2] - p[0];
+        if (std::fabs(edge1.x * edge2.y - edge1.y * edge2.x) < 1e-6f) return false;
+
+        for (int k = 0; k < 3; ++k) {
+            t.v[k].x = screen_x + (p[k].x + 1.0f) * 0.5f * screen_width;
+            t.v[k].y = screen_y + (1.0f - p[k].y) * 0.5f * screen_height;
+            t.v[k].z = (p[k].z + 1.0f) * 0.5f;
+        }
+        return true;
+    };
+
+    Screen_triangle t = {};
+    t.item = uint32_t(chunk.object);
+    Clip_vertex scratch[2 * MAX_CLIP_VERTICES]; // Clipping polygons, ping-ponged by clip_planes
+
+    for (size_t tri = chunk.begin; tri < chunk.end; ++tri) {
+        counts.submitted++;
+
+        uint32_t ia, ib, ic;
+        if (cluster) {
+            while (tri * 3 >= size_t(cluster->first_index) + cluster->index_count) ++cluster;
+            quantized->get_triangle(*cluster, tri * 3, ia, ib, ic);
+        } else {
+            ia = inds[tri * 3]; ib = inds[tri * 3 + 1]; ic = inds[tri * 3 + 2];
+        }
+        int code_a = in_codes[ia], code_b = in_codes[ib], code_c = in_codes[ic];
+
+        // All vertices outside the same plane
+        if (code_a & code_b & code_c) {
+            counts.rejected++;
+            continue;
+        }
+
+        t.id = b.base_id + uint32_t(tri);
+        if (!filled) {
+            if ((code_a | code_b | code_c) == 0) {
+                if (to_lines(in_clip[ia], in_clip[ib], in_clip[ic], t)) out.push_back(t);
+                else counts.degenerate++;
+                continue;
+            }
+
+            counts.clipped++;
+            size_t count;
+            const Clip_vertex* poly = clip_planes({in_clip[ia], in_clip[ib], in_clip[ic]}, scratch, count);
+            for (size_t k = 1; k + 1 < count; ++k) {
+                if (to_lines(poly[0].pos, poly[k].pos, poly[k + 1].pos, t)) out.push_back(t);
+                else counts.degenerate++;
+            }
+            continue;
+        }
+
+        Vec3 ca = in_colors[ia], cb = in_colors[ib], cc = in_colors[ic];
+        if (flat) {
+            // Face normal from winding, lit from both sides since meshes don't keep winding consistent
+            Vec3 pa, pb, pc;
+            if (packed) {
+                pa = Vec3(packed[ia].x, packed[ia].y, packed[ia].z);
+                pb = Vec3(packed[ib].x, packed[ib].y, packed[ib].z);
+                pc = Vec3(packed[ic].x, packed[ic].y, packed[ic].z);
+            } else {
+                pa = verts[ia];
+                pb = verts[ib];
+                pc = verts[ic];
+            }
+            Vec3 n = face_matrix.transform_dir((pb - pa).cross(pc - pa)).norm();
+            ca = ca * (ambient + (1.0f - ambient) * std::fabs(n.dot(to_light)));
+            cb = ca;
+            cc = ca;
+        }
+
+        Vec2 ua, ub, uc;
+        if (uvs) {
+            ua = uvs[ia];
+            ub = uvs[ib];
+            uc = uvs[ic];
+        }
+
+        // Fully inside, no clipping needed
+        if ((code_a | code_b | code_c) == 0) {
+            t.v[0] = to_raster(in_clip[ia], ca, ua);
+            t.v[1] = to_raster(in_clip[ib], cb, ub);
+            t.v[2] = to_raster(in_clip[ic], cc, uc);
+            if (degenerate(t.v[0], t.v[1], t.v[2])) {
+                counts.degenerate++;
+                continue;
+            }
+            if (texture) t.level = texture_level(*texture, t.v, 3);
+            out.push_back(t);
+            continue;
+        }
+
+        counts.clipped++;
+        size_t count;
+        const Clip_vertex* poly = clip_planes({in_clip[ia], in_clip[ib], in_clip[ic]}, scratch, count);
+        if (count < 3) continue;
+
+        // The pieces of a clipped triangle share the level of the whole polygon
+        Raster_vertex raster[MAX_CLIP_VERTICES];
+        for (size_t k = 0; k < count; ++k) {
+            const Vec3& w = poly[k].weights;
+            raster[k] = to_raster(poly[k].pos, ca * w.x + cb * w.y + cc * w.z, ua * w.x + ub * w.y + uc * w.z);
+        }
+        if (texture) t.level = texture_level(*texture, raster, count);
+
+        for (size_t f = 1; f + 1 < count; ++f) {
+            t.v[0] = raster[0];
+            t.v[1] = raster[f];
+            t.v[2] = raster[f + 1];
+            if (degenerate(t.v[0], t.v[1], t.v[2])) {
+                counts.degenerate++;
+                continue;
+            }
+            out.push_back(t);
+        }
+    }
 }
 
 // Draws a line to the framebuffer between two points 
 void Renderer::draw_line(Vec3 v0, Vec3 v1, uint32_t color) {
+    if (aa_lines) {
+        draw_line_aa(v0, v1, color);
+        return;
+    }
+
     int x0 = int(v0.x), y0 = int(v0.y);
     int x1 = int(v1.x), y1 = int(v1.y);
     
     float z0 = v0.z;
     float z1 = v1.z;
 
+    PROFILE_COUNT(profiler, Counter::Lines_drawn, 1);
+
     int dx = std::abs(x1 - x0);
     int dy = std::abs(y1 - y0);
     int steps = std::max(dx, dy);
 
     for (int i = 0; i <= steps; ++i) {
         float t = steps > 0 ? float(i) / steps : 0;
-        int x = clamp(int(std::round(x0 + (x1 - x0) * t)), 0, ssaa ? ssaa_width - 1 : width - 1);
-        int y = clamp(int(std::round(y0 + (y1 - y0) * t)), 0, ssaa ? ssaa_height - 1 : height - 1);
+        int x = clamp(int(std::round(x0 + (x1 - x0) * t)), viewport.x0, viewport.x1 - 1);
+        int y = clamp(int(std::round(y0 + (y1 - y0) * t)), viewport.y0, viewport.y1 - 1);
+        if (x < scissor.x0 || x >= scissor.x1 || y < scissor.y0 || y >= scissor.y1) continue;
         float z = z0 + (z1 - z0) * t;
         put_pixel(x, y, z, color);
     }
 }
 
+// Draw line with Wu style coverage. Each step along the major axis covers the
+// two pixels straddling the line, weighted by distance to their centers.
+void Renderer::draw_line_aa(Vec3 v0, Vec3 v1, uint32_t color) {
+    PROFILE_COUNT(profiler, Counter::Lines_drawn, 1);
+
+    // Pixel centers sit at +0.5, shift so they land on integers
+    float x0 = v0.x - 0.5f, y0 = v0.y - 0.5f, z0 = v0.z;
+    float x1 = v1.x - 0.5f, y1 = v1.y - 0.5f, z1 = v1.z;
+
+    bool steep = std::fabs(y1 - y0) > std::fabs(x1 - x0);
+    if (steep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        std::swap(z0, z1);
+    }
+
+    float dx = x1 - x0;
+    float gradient = dx > 1e-6f ? (y1 - y0) / dx : 0.0f;
+    float dz = dx > 1e-6f ? (z1 - z0) / dx : 0.0f;
+
+    // Plot in unswapped coordinates
+    auto plot = [this, steep](int major, int minor, float z, uint32_t c, float coverage) {
+        if (steep) blend_pixel(minor, major, z, c, coverage);
+        else blend_pixel(major, minor, z, c, coverage);
+    };
+
+    // Endpoints cover their pixel by the fraction of it the line spans
+    int xpx0 = int(std::round(x0));
+    int xpx1 = int(std::round(x1));
+    if (xpx0 == xpx1) {
+        float y = y0 + gradient * (xpx0 - x0);
+        int ypx = int(std::floor(y));
+        float f = y - ypx;
+        float span = x1 - x0;
+        plot(xpx0, ypx, z0, color, (1.0f - f) * span);
+        plot(xpx0, ypx + 1, z0, color, f * span);
+        return;
+    }
+
+    float y_end = y0 + gradient * (xpx0 - x0);
+    float gap = 1.0f - ((x0 + 0.5f) - std::floor(x0 + 0.5f));
+    int ypx = int(std::floor(y_end));
+    float f = y_end - ypx;
+    float z = z0 + dz * (xpx0 - x0);
+    plot(xpx0, ypx, z, color, (1.0f - f) * gap);
+    plot(xpx0, ypx + 1, z, color, f * gap);
+
+    y_end = y1 + gradient * (xpx1 - x1);
+    gap = (x1 + 0.5f) - std::floor(x1 + 0.5f);
+    ypx = int(std::floor(y_end));
+    f = y_end - ypx;
+    z = z1 + dz * (xpx1 - x1);
+    plot(xpx1, ypx, z, color, (1.0f - f) * gap);
+    plot(xpx1, ypx + 1, z, color, f * gap);
+
+    // Span between the endpoints, clamped to the viewport so off screen parts cost
+    // nothing. Steps up to the scissor accumulate like the full draw.
+    int first = std::max(xpx0 + 1, steep ? viewport.y0 : viewport.x0);
+    int last = std::min(xpx1 - 1, (steep ? scissor.y1 : scissor.x1) - 1);
+
+    float y = y0 + gradient * (first - x0);
+    z = z0 + dz * (first - x0);
+    for (int x = first; x < (steep ? scissor.y0 : scissor.x0) && x <= last; ++x) {
+        y += gradient;
+        z += dz;
+    }
+    for (int x = std::max(first, steep ? scissor.y0 : scissor.x0); x <= last; ++x) {
+        int iy = int(std::floor(y));
+        float fy = y - iy;
+        plot(x, iy, z, color, 1.0f - fy);
+        plot(x, iy + 1, z, color, fy);
+        y += gradient;
+        z += dz;
+    }
+}
+
+// Blend color into a pixel by coverage if it passes the depth test
+void Renderer::blend_pixel(int x, int y, float z, uint32_t color, float coverage) {
+    if (x < scissor.x0 || x >= scissor.x1 || y < scissor.y0 || y >= scissor.y1) return;
+
+    int weight = int(std::min(coverage, 1.0f) * 256.0f + 0.5f);
+    if (weight <= 0) return;
+
+    z = clamp(z, 0.0f, 1.0f);
+    int index = sample_index(x, y);
+    if (!(z < zbuffer[index])) {
+        PROFILE_COUNT(profiler, Counter::Depth_fail, 1);
+        OVERDRAW_COUNT(overdraw, index, false);
+        return;
+    }
+    PROFILE_COUNT(profiler, Counter::Depth_pass, 1);
+    OVERDRAW_COUNT(overdraw, index, true);
+    PROFILE_COUNT(profiler, Counter::Pixels_drawn, 1);
+
+    // Partially covered pixels stay transparent to lines behind them
+    if (weight >= 128) zbuffer[index] = z;
+
+    uint32_t* target = ssaa ? ssaa_buffer : framebuffer;
+    uint32_t dst = target[index];
+    uint32_t rb = ((color & 0xFF00FF) * weight + (dst & 0xFF00FF) * (256 - weight)) >> 8;
+    uint32_t g = ((color & 0x00FF00) * weight + (dst & 0x00FF00) * (256 - weight)) >> 8;
+    target[index] = 0xFF000000 | (rb & 0xFF00FF) | (g & 0x00FF00);
+    if (visibility) id_buffer[index] = 0;
+}
+
 // Set color of pixel with respect to depth
 void Renderer::put_pixel(int x, int y, float z, uint32_t color) {
     z = clamp(z, 0.0f, 1.0f);
     if (ssaa) {
         if (x < 0 || x >= ssaa_width || y < 0 || y >= ssaa_height) return;
-        int index = y * ssaa_width + x;
+        int index = sample_index(x, y);
 
         if (z < zbuffer[index]) {
             zbuffer[index] = z;
             ssaa_buffer[index] = color;
+            if (visibility) id_buffer[index] = 0;
+            PROFILE_COUNT(profiler, Counter::Depth_pass, 1);
+            OVERDRAW_COUNT(overdraw, index, true);
+            PROFILE_COUNT(profiler, Counter::Pixels_drawn, 1);
+        } else {
+            PROFILE_COUNT(profiler, Counter::Depth_fail, 1);
+            OVERDRAW_COUNT(overdraw, index, false);
         }
 
     } else {
@@ -193,6 +1194,13 @@ void Renderer::put_pixel(int x, int y, float z, uint32_t color) {
         if (z < zbuffer[index]) {
             zbuffer[index] = z;
             framebuffer[index] = color;
+            if (visibility) id_buffer[index] = 0;
+            PROFILE_COUNT(profiler, Counter::Depth_pass, 1);
+            OVERDRAW_COUNT(overdraw, index, true);
+            PROFILE_COUNT(profiler, Counter::Pixels_drawn, 1);
+        } else {
+            PROFILE_COUNT(profiler, Counter::Depth_fail, 1);
+            OVERDRAW_COUNT(overdraw, index, false);
         }
     }
 }
@@ -201,16 +1209,40 @@ void Renderer::put_pixel(int x, int y, float z, uint32_t color) {
 void Renderer::put_pixel(int x, int y, uint32_t color) {
     if (x < 0 || x >= width || y < 0 || y >= height) return; // Check if pixel is on screen
     framebuffer[y * width + x] = color;
-    
+    PROFILE_COUNT(profiler, Counter::Pixels_drawn, 1);
 }
 
 // Clears display with one color
 void Renderer::clear(uint32_t color) {
-    if (ssaa) std::fill(ssaa_buffer, ssaa_buffer + (ssaa_size), color);
-    else std::fill(framebuffer, framebuffer + (size), color);
-    
-    std::fill(zbuffer.begin(), zbuffer.end(), std::numeric_limits<float>::infinity());
+    PROFILE_SCOPE(profiler, Stage::Clear);
+
+    // With dirty regions render() clears only what changed, or everything if it can't tell
+    if (color != clear_color) scene_valid = false;
+    clear_color = color;
+    frame_batches = 0;
+    partial = false;
+    if (dirty_regions && scene_valid) clear_pending = true;
+    else clear_target();
+
+    if (visibility) {
+        std::fill(id_buffer.begin(), id_buffer.begin() + (ssaa ? ssaa_size : size), 0);
+        vis_objects.clear();
+        vis_clip_verts.clear();
+        vis_colors.clear();
+        vis_next_id = 1;
+    }
 
+    if (occlusion) std::fill(occlusion_depth.begin(), occlusion_depth.end(), std::numeric_limits<float>::infinity());
+    if (overdraw.is_enabled()) overdraw.clear(size_t(ssaa ? ssaa_size : size));
+}
+
+// Fill color and depth samples of the whole target
+void Renderer::clear_target() {
+    if (ssaa) std::fill(ssaa_buffer, ssaa_buffer + (ssaa_size), clear_color);
+    else std::fill(framebuffer, framebuffer + (size), clear_color);
+
+    std::fill(zbuffer.begin(), zbuffer.begin() + (ssaa ? ssaa_size : size), std::numeric_limits<float>::infinity());
+    clear_pending = false;
 }
 
 // Render a rotating box
@@ -240,31 +1272,139 @@ Vec4 Renderer::model_to_clip(const Vec3& vertex, const Mat4& model_matrix) const
 
 // Display framebuffer on screen
 void Renderer::show() {
-    if (ssaa) {
-        for (int y = 0; y < height; ++y) {
-            for (int x = 0; x < width; ++x) {
-                uint64_t a = 0, r = 0, g = 0, b = 0;
-                for (int dy = 0; dy < ssaa_factor; ++dy) {
-                    for (int dx = 0; dx < ssaa_factor; ++dx) {
-                        uint32_t color = ssaa_buffer[(y * ssaa_factor + dy) * ssaa_width + (x * ssaa_factor + dx)];
-                        a += (color >> 24) & 0xFF;
-                        r += (color >> 16) & 0xFF;
-                        g += (color >> 8)  & 0xFF;
-                        b += color & 0xFF;
-                    }
+    // A frame without render() still owes its clear
+    if (clear_pending) {
+        PROFILE_SCOPE(profiler, Stage::Clear);
+        clear_target();
+        scene_valid = false;
+    }
+    resolve();
+
+    if (display) {
+        PROFILE_SCOPE(profiler, Stage::Present);
+        if (partial) {
+            for (const Rect& r : present_rects) {
+                XPutImage(display, window, gc, ximage, r.x0, r.y0, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0);
+            }
+        } else {
+            XPutImage(display, window, gc, ximage, 0, 0, 0, 0, width, height);
+        }
+    }
+    partial = false;
+
+#ifdef POLYRENDER_PROFILE
+    profiler.end_frame();
+#endif
+}
+
+// Resolve SSAA buffer into framebuffer
+void Renderer::resolve() {
+    if (visibility) shade_visibility();
+
+    // Heatmap replaces the shaded samples before they are filtered like colors
+    if (overdraw.is_enabled()) {
+        size_t samples = size_t(ssaa ? ssaa_size : size);
+        overdraw_stats = overdraw.summarize(samples);
+        overdraw.apply_heatmap(ssaa ? ssaa_buffer : framebuffer, samples);
+    }
+    if (!ssaa) return;
+
+    PROFILE_SCOPE(profiler, Stage::Resolve);
+    if (!partial) {
+        resolve_area({0, 0, width, height});
+        return;
+    }
+    for (const Rect& r : present_rects) resolve_area(r);
+}
+
+// Resolve window pixels of area from the SSAA buffer
+void Renderer::resolve_area(const Rect& area) {
+    if (ssaa_width == width && ssaa_height == height) resolve_detile(area);
+    else if (ssaa_width == width * ssaa_factor && ssaa_height == height * ssaa_factor) resolve_box_integer(area);
+    else if (ssaa_width >= width && ssaa_height >= height) resolve_box(area);
+    else resolve_bilinear(area);
+}
+
+// Copy a tiled buffer of window size into the framebuffer
+void Renderer::resolve_detile(const Rect& area) {
+    for (int y = area.y0; y < area.y1; ++y) {
+        const uint32_t* row = ssaa_buffer + row_offset[y];
+        uint32_t* out = framebuffer + y * width;
+        for (int x = area.x0; x < area.x1; ++x) out[x] = row[col_offset[x]];
+    }
+}
+
+// Average factor x factor samples per pixel
+void Renderer::resolve_box_integer(const Rect& area) {
+    for (int y = area.y0; y < area.y1; ++y) {
+        for (int x = area.x0; x < area.x1; ++x) {
+            uint64_t a = 0, r = 0, g = 0, b = 0;
+            for (int dy = 0; dy < ssaa_factor; ++dy) {
+                const uint32_t* row = ssaa_buffer + row_offset[y * ssaa_factor + dy];
+                for (int dx = 0; dx < ssaa_factor; ++dx) {
+                    uint32_t color = row[col_offset[x * ssaa_factor + dx]];
+                    a += (color >> 24) & 0xFF;
+                    r += (color >> 16) & 0xFF;
+                    g += (color >> 8)  & 0xFF;
+                    b += color & 0xFF;
                 }
+            }
+
+            uint32_t color = 
+                ((a / ssaa_samples) << 24) |
+                ((r / ssaa_samples) << 16) |
+                ((g / ssaa_samples) << 8)  |
+                (b / ssaa_samples);
+            framebuffer[y * width + x] = color;
+        }
+    }
+}
 
-                uint32_t color = 
-                    ((a / ssaa_samples) << 24) |
-                    ((r / ssaa_samples) << 16) |
-                    ((g / ssaa_samples) << 8)  |
-                    (b / ssaa_samples);
-                framebuffer[y * width + x] = color;
+// Average the samples covered by each pixel of a buffer larger than the window
+void Renderer::resolve_box(const Rect& area) {
+    for (int y = area.y0; y < area.y1; ++y) {
+        int sy0 = resolve_y0[y], sy1 = resolve_y1[y];
+        for (int x = area.x0; x < area.x1; ++x) {
+            int sx0 = resolve_x0[x], sx1 = resolve_x1[x];
+            uint32_t a = 0, r = 0, g = 0, b = 0;
+            for (int sy = sy0; sy < sy1; ++sy) {
+                const uint32_t* row = ssaa_buffer + row_offset[sy];
+                for (int sx = sx0; sx < sx1; ++sx) {
+                    uint32_t color = row[col_offset[sx]];
+                    a += (color >> 24) & 0xFF;
+                    r += (color >> 16) & 0xFF;
+                    g += (color >> 8)  & 0xFF;
+                    b += color & 0xFF;
+                }
             }
+
+            uint32_t count = uint32_t((sy1 - sy0) * (sx1 - sx0));
+            framebuffer[y * width + x] =
+                ((a / count) << 24) | ((r / count) << 16) | ((g / count) << 8) | (b / count);
+        }
+    }
+}
+
+// Bilinear upscale of a buffer smaller than the window
+void Renderer::resolve_bilinear(const Rect& area) {
+    // Blend two ARGB colors with an 8 bit weight of the second
+    auto lerp = [](uint32_t c0, uint32_t c1, int w) {
+        uint32_t rb = (((c0 & 0x00FF00FF) * (256 - w) + (c1 & 0x00FF00FF) * w) >> 8) & 0x00FF00FF;
+        uint32_t ag = ((((c0 >> 8) & 0x00FF00FF) * (256 - w) + ((c1 >> 8) & 0x00FF00FF) * w)) & 0xFF00FF00;
+        return rb | ag;
+    };
+
+    for (int y = area.y0; y < area.y1; ++y) {
+        const uint32_t* row0 = ssaa_buffer + row_offset[resolve_y0[y]];
+        const uint32_t* row1 = ssaa_buffer + row_offset[resolve_y1[y]];
+        int wy = resolve_wy[y];
+        for (int x = area.x0; x < area.x1; ++x) {
+            int x0 = col_offset[resolve_x0[x]], x1 = col_offset[resolve_x1[x]], wx = resolve_wx[x];
+            uint32_t top = lerp(row0[x0], row0[x1], wx);
+            uint32_t bottom = lerp(row1[x0], row1[x1], wx);
+            framebuffer[y * width + x] = lerp(top, bottom, wy);
         }
     }
-    
-    XPutImage(display, window, gc, ximage, 0, 0, 0, 0, width, height);
 }
 
 // Add object to the scene
@@ -272,11 +1412,31 @@ void Renderer::add_object(Renderable* obj) {
     objects.push_back(obj);
 }
 
+// FNV-1a hash of the resolved framebuffer
+uint64_t Renderer::framebuffer_checksum() const {
+    uint64_t hash = 14695981039346656037ull;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(framebuffer);
+    for (size_t i = 0; i < size_t(size) * sizeof(uint32_t); ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Remove all objects from the scene
+void Renderer::clear_objects() {
+    objects.clear();
+}
+
 // Clamps screen coordinates
 inline int Renderer::clamp(int value, int min, int max) {
     return std::max(min, std::min(value, max));
 }
 
+inline float Renderer::clamp(float value, float min, float max) {
+    return std::max(min, std::min(value, max));
+}
+
 // Helper to comute barycentric coordinates
 inline bool Renderer::barycentric(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c, float& u, float& v, float& w) {
     Vec3 v0 = b - a;
@@ -301,26 +1461,495 @@ inline bool Renderer::barycentric(const Vec3& p, const Vec3& a, const Vec3& b, c
 
 // Rasterize a single trinagle
 void Renderer::draw_triangle(const Vec3& v0, const Vec3& v1, const Vec3& v2, uint32_t color) {
-    int minX = clamp((int)std::floor(std::min({v0.x, v1.x, v2.x})), 0, ssaa ? ssaa_width - 1 : width - 1);
-    int maxX = clamp((int)std::ceil(std::max({v0.x, v1.x, v2.x})), 0, ssaa ? ssaa_width - 1 : width -1 );
-    int minY = clamp((int)std::floor(std::min({v0.y, v1.y, v2.y})), 0, ssaa ? ssaa_height - 1 : height - 1);
-    int maxY = clamp((int)std::ceil(std::max({v0.y, v1.y, v2.y})), 0, ssaa ? ssaa_height - 1 : height - 1);
-
-    for (int y = minY; y <= maxY; ++y) {
-        for (int x = minX; x <=maxX; ++x) {
-            Vec3 p((float)x + 0.5f, (float)y + 0.5f, 0.0f);
-            float u, v, w;
-            if (barycentric(p, v0, v1, v2, u, v, w)) {
-                // Interpolate depth
-                float z = u * v0.z + v * v1.z + w * v2.z;
-
-                // Write pixel with depth test
-                put_pixel(x, y, z, color);
+    Vec3 c = unpack_color(color);
+    draw_triangle(Raster_vertex{v0.x, v0.y, v0.z, 1.0f, c.x, c.y, c.z, 0.0f, 0.0f},
+                  Raster_vertex{v1.x, v1.y, v1.z, 1.0f, c.x, c.y, c.z, 0.0f, 0.0f},
+                  Raster_vertex{v2.x, v2.y, v2.z, 1.0f, c.x, c.y, c.z, 0.0f, 0.0f});
+}
+
+// Edge function of p to q with x, y steps and top left fill rule
+struct Raster_edge {
+    float dx, dy, c;
+    bool top_left;
+    float at(float x, float y) const { return dx * x + dy * y + c; }
+    bool inside(float e) const { return e > 0.0f || (e == 0.0f && top_left); }
+};
+
+// Plane equation of an attribute over the screen
+struct Raster_plane {
+    float dx, dy, c;
+    float at(float x, float y) const { return dx * x + dy * y + c; }
+};
+
+// Per triangle setup shared by the rasterizers
+struct Triangle_setup {
+    const Renderer::Raster_vertex* v[3]; // Vertices, oriented so edges are positive inside
+    Raster_edge e[3];                     // Edge opposite each vertex, its barycentric weight
+    float inv_area;
+    int minX, maxX, minY, maxY;
+
+    // Plane equation of an attribute from its vertex values
+    Raster_plane plane(float f0, float f1, float f2) const {
+        Raster_plane p;
+        p.dx = (e[0].dx * f0 + e[1].dx * f1 + e[2].dx * f2) * inv_area;
+        p.dy = (e[0].dy * f0 + e[1].dy * f1 + e[2].dy * f2) * inv_area;
+        p.c = (e[0].c * f0 + e[1].c * f1 + e[2].c * f2) * inv_area;
+        return p;
+    }
+
+    bool inside(float w0, float w1, float w2) const {
+        return e[0].inside(w0) && e[1].inside(w1) && e[2].inside(w2);
+    }
+};
+
+// Orient triangle, build edge functions and clamp bounds to the pixel rectangle
+// [x0, x1) x [y0, y1), false if nothing to draw
+static bool setup_triangle(const Renderer::Raster_vertex& v0, const Renderer::Raster_vertex& v1,
+                           const Renderer::Raster_vertex& v2, int x0, int y0, int x1, int y1,
+                           Triangle_setup& t) {
+    const Renderer::Raster_vertex* a = &v0;
+    const Renderer::Raster_vertex* b = &v1;
+    const Renderer::Raster_vertex* c = &v2;
+    float area = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+    if (area < 1e-8f) return false;
+
+    t.minX = std::max(x0, (int)std::floor(std::min({a->x, b->x, c->x})));
+    t.maxX = std::min(x1 - 1, (int)std::ceil(std::max({a->x, b->x, c->x})));
+    t.minY = std::max(y0, (int)std::floor(std::min({a->y, b->y, c->y})));
+    t.maxY = std::min(y1 - 1, (int)std::ceil(std::max({a->y, b->y, c->y})));
+    if (t.minX > t.maxX || t.minY > t.maxY) return false;
+
+    auto make_edge = [](const Renderer::Raster_vertex* p, const Renderer::Raster_vertex* q) {
+        Raster_edge e;
+        e.dx = -(q->y - p->y);
+        e.dy = q->x - p->x;
+        e.c = -(e.dx * p->x + e.dy * p->y);
+        e.top_left = (q->y == p->y && q->x > p->x) || q->y < p->y;
+        return e;
+    };
+
+    t.v[0] = a;
+    t.v[1] = b;
+    t.v[2] = c;
+    t.e[0] = make_edge(b, c);
+    t.e[1] = make_edge(c, a);
+    t.e[2] = make_edge(a, b);
+    t.inv_area = 1.0f / area;
+    return true;
+}
+
+// Rasterize a single triangle with perspective correct color and texture
+// coordinate interpolation. Edge functions and attributes are set up once as
+// plane equations and stepped with adds across each row.
+void Renderer::draw_triangle(const Raster_vertex& v0, const Raster_vertex& v1, const Raster_vertex& v2,
+                             const Texture* texture, int level) {
+    uint32_t* target = ssaa ? ssaa_buffer : framebuffer;
+
+    Triangle_setup t;
+    if (!setup_triangle(v0, v1, v2, viewport.x0, viewport.y0, viewport.x1, viewport.y1, t)) return;
+
+    // Rows start at the viewport bounds and step up to the scissor, so clipped
+    // draws accumulate attributes exactly like the full draw
+    int first_x = std::max(t.minX, scissor.x0), last_x = std::min(t.maxX, scissor.x1 - 1);
+    int first_y = std::max(t.minY, scissor.y0), last_y = std::min(t.maxY, scissor.y1 - 1);
+    if (first_x > last_x || first_y > last_y) return;
+    const Raster_vertex* a = t.v[0];
+    const Raster_vertex* b = t.v[1];
+    const Raster_vertex* c = t.v[2];
+
+    Raster_plane pz = t.plane(a->z, b->z, c->z);
+
+    // Constant color needs no perspective correction
+    bool flat = a->r == b->r && a->r == c->r && a->g == b->g && a->g == c->g && a->b == b->b && a->b == c->b;
+    uint32_t flat_color = pack_color(a->r, a->g, a->b);
+    Raster_plane pw = t.plane(a->inv_w, b->inv_w, c->inv_w);
+    Raster_plane pr = t.plane(a->r * a->inv_w, b->r * b->inv_w, c->r * c->inv_w);
+    Raster_plane pg = t.plane(a->g * a->inv_w, b->g * b->inv_w, c->g * c->inv_w);
+    Raster_plane pb = t.plane(a->b * a->inv_w, b->b * b->inv_w, c->b * c->inv_w);
+    Raster_plane pu = {0.0f, 0.0f, 0.0f}, pv = {0.0f, 0.0f, 0.0f};
+    if (texture) {
+        pu = t.plane(a->u * a->inv_w, b->u * b->inv_w, c->u * c->inv_w);
+        pv = t.plane(a->v * a->inv_w, b->v * b->inv_w, c->v * c->inv_w);
+    }
+
+    for (int y = first_y; y <= last_y; ++y) {
+        float px = t.minX + 0.5f, py = y + 0.5f;
+        float w0 = t.e[0].at(px, py), w1 = t.e[1].at(px, py), w2 = t.e[2].at(px, py);
+        float z = pz.at(px, py);
+        float iw = pw.at(px, py), rw = pr.at(px, py), gw = pg.at(px, py), bw = pb.at(px, py);
+        float uw = pu.at(px, py), vw = pv.at(px, py);
+        for (int x = t.minX; x < first_x; ++x) {
+            w0 += t.e[0].dx; w1 += t.e[1].dx; w2 += t.e[2].dx;
+            z += pz.dx;
+            iw += pw.dx; rw += pr.dx; gw += pg.dx; bw += pb.dx;
+            uw += pu.dx; vw += pv.dx;
+        }
+
+        const int row = row_offset[y];
+        for (int x = first_x; x <= last_x; ++x) {
+            if (t.inside(w0, w1, w2)) {
+                int index = row + col_offset[x];
+                if (z < zbuffer[index]) {
+                    zbuffer[index] = z;
+                    if (visibility) id_buffer[index] = 0;
+                    if (texture) {
+                        float w = 1.0f / iw;
+                        uint32_t texel = texture->sample(level, uw * w, vw * w);
+                        target[index] = flat ? modulate_color(texel, a->r, a->g, a->b)
+                                             : modulate_color(texel, rw * w, gw * w, bw * w);
+                    } else if (flat) {
+                        target[index] = flat_color;
+                    } else {
+                        float w = 1.0f / iw;
+                        target[index] = pack_color(rw * w, gw * w, bw * w);
+                    }
+                    PROFILE_COUNT(profiler, Counter::Depth_pass, 1);
+                    OVERDRAW_COUNT(overdraw, index, true);
+                    PROFILE_COUNT(profiler, Counter::Pixels_drawn, 1);
+                } else {
+                    PROFILE_COUNT(profiler, Counter::Depth_fail, 1);
+                    OVERDRAW_COUNT(overdraw, index, false);
+                }
+            }
+
+            w0 += t.e[0].dx; w1 += t.e[1].dx; w2 += t.e[2].dx;
+            z += pz.dx;
+            iw += pw.dx; rw += pr.dx; gw += pg.dx; bw += pb.dx;
+            uw += pu.dx; vw += pv.dx;
+        }
+    }
+}
+
+// Rasterize a single triangle into the visibility buffer, writes only depth and id
+void Renderer::draw_triangle_id(const Raster_vertex& v0, const Raster_vertex& v1, const Raster_vertex& v2, uint32_t id) {
+    Triangle_setup t;
+    if (!setup_triangle(v0, v1, v2, viewport.x0, viewport.y0, viewport.x1, viewport.y1, t)) return;
+
+    Raster_plane pz = t.plane(t.v[0]->z, t.v[1]->z, t.v[2]->z);
+
+    for (int y = t.minY; y <= t.maxY; ++y) {
+        float px = t.minX + 0.5f, py = y + 0.5f;
+        float w0 = t.e[0].at(px, py), w1 = t.e[1].at(px, py), w2 = t.e[2].at(px, py);
+        float z = pz.at(px, py);
+
+        const int row = row_offset[y];
+        for (int x = t.minX; x <= t.maxX; ++x) {
+            if (t.inside(w0, w1, w2)) {
+                int index = row + col_offset[x];
+                if (z < zbuffer[index]) {
+                    zbuffer[index] = z;
+                    id_buffer[index] = id;
+                    PROFILE_COUNT(profiler, Counter::Depth_pass, 1);
+                    OVERDRAW_COUNT(overdraw, index, true);
+                } else {
+                    PROFILE_COUNT(profiler, Counter::Depth_fail, 1);
+                    OVERDRAW_COUNT(overdraw, index, false);
+                }
+            }
+
+            w0 += t.e[0].dx; w1 += t.e[1].dx; w2 += t.e[2].dx;
+            z += pz.dx;
+        }
+    }
+}
+
+// Shade every visible sample of the visibility buffer once
+void Renderer::shade_visibility() {
+    if (vis_objects.empty()) return;
+
+    PROFILE_SCOPE(profiler, Stage::Shade);
+    int target_width = ssaa ? ssaa_width : width;
+    int target_height = ssaa ? ssaa_height : height;
+    uint32_t* target = ssaa ? ssaa_buffer : framebuffer;
+    float step_x = 2.0f / target_width;
+    float step_y = 2.0f / target_height;
+    Vec3 to_light = light_dir * -1.0f;
+
+    // Triangle of the last shaded sample, neighbours mostly share it
+    uint32_t last_id = 0;
+    Vec4 p[3];
+    Vec3 c[3];
+    Vec2 uv[3];
+    bool flat = false;
+    Vec3 flat_shade;
+    uint32_t flat_color = 0;
+    const Texture* texture = nullptr;
+    int level = 0;
+
+    for (int y = 0; y < target_height; ++y) {
+        float ny = 1.0f - (y + 0.5f) * step_y;
+        const int row = row_offset[y];
+        for (int x = 0; x < target_width; ++x) {
+            int index = row + col_offset[x];
+            uint32_t id = id_buffer[index];
+            if (id == 0) continue;
+
+            if (id != last_id) {
+                // Object owning the id, last one with base_id <= id
+                auto it = std::upper_bound(vis_objects.begin(), vis_objects.end(), id,
+                    [](uint32_t value, const Vis_object& o) { return value < o.base_id; });
+                const Vis_object& object = *(it - 1);
+                const Quantized_mesh* quantized = object.obj->get_quantized();
+                const auto& inds = object.obj->get_indices();
+                size_t first = size_t(id - object.base_id) * 3;
+
+                uint32_t corner[3];
+                if (quantized) {
+                    quantized->get_triangle(quantized->find_cluster(first), first, corner[0], corner[1], corner[2]);
+                } else {
+                    for (int k = 0; k < 3; ++k) corner[k] = inds[first + k];
+                }
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = vis_clip_verts[object.vertex_offset + corner[k]];
+                    c[k] = vis_colors[object.vertex_offset + corner[k]];
+                }
+
+                flat = !object.gouraud;
+                if (flat) {
+                    Vec3 v[3];
+                    for (int k = 0; k < 3; ++k) {
+                        v[k] = quantized ? quantized->get_position(corner[k]) : object.obj->get_vertices()[corner[k]];
+                    }
+                    Vec3 n = object.normal_matrix.transform_dir((v[1] - v[0]).cross(v[2] - v[0])).norm();
+                    flat_shade = c[0] * (ambient + (1.0f - ambient) * std::fabs(n.dot(to_light)));
+                    flat_color = pack_color(flat_shade.x, flat_shade.y, flat_shade.z);
+                }
+
+                // Level of the visible part of the triangle, like the forward path picks it
+                texture = object.texture;
+                if (texture) {
+                    const auto& uvs = object.obj->get_uvs();
+                    for (int k = 0; k < 3; ++k) uv[k] = uvs[corner[k]];
+
+                    Clip_vertex scratch[2 * MAX_CLIP_VERTICES];
+                    Raster_vertex raster[MAX_CLIP_VERTICES];
+                    size_t count;
+                    const Clip_vertex* poly = clip_planes({p[0], p[1], p[2]}, scratch, count);
+                    for (size_t k = 0; k < count; ++k) {
+                        const Vec3& w = poly[k].weights;
+                        float inv_w = 1.0f / poly[k].pos.w;
+                        raster[k].x = (poly[k].pos.x * inv_w + 1.0f) * 0.5f * target_width;
+                        raster[k].y = (1.0f - poly[k].pos.y * inv_w) * 0.5f * target_height;
+                        raster[k].u = uv[0].x * w.x + uv[1].x * w.y + uv[2].x * w.z;
+                        raster[k].v = uv[0].y * w.x + uv[1].y * w.y + uv[2].y * w.z;
+                    }
+                    level = count >= 3 ? texture_level(*texture, raster, count) : 0;
+                }
+                last_id = id;
+            }
+
+            if (flat && !texture) {
+                target[index] = flat_color;
+            } else {
+                // Perspective correct barycentrics of the sample on the unclipped triangle
+                float nx = (x + 0.5f) * step_x - 1.0f;
+                Vec3 rx(p[0].x - nx * p[0].w, p[1].x - nx * p[1].w, p[2].x - nx * p[2].w);
+                Vec3 ry(p[0].y - ny * p[0].w, p[1].y - ny * p[1].w, p[2].y - ny * p[2].w);
+                Vec3 bary = rx.cross(ry);
+                float sum = bary.x + bary.y + bary.z;
+                if (std::fabs(sum) < 1e-20f) continue;
+                bary = bary * (1.0f / sum);
+
+                Vec3 color = flat ? flat_shade : c[0] * bary.x + c[1] * bary.y + c[2] * bary.z;
+                if (texture) {
+                    float u = uv[0].x * bary.x + uv[1].x * bary.y + uv[2].x * bary.z;
+                    float v = uv[0].y * bary.x + uv[1].y * bary.y + uv[2].y * bary.z;
+                    target[index] = modulate_color(texture->sample(level, u, v), color.x, color.y, color.z);
+                } else {
+                    target[index] = pack_color(color.x, color.y, color.z);
+                }
+            }
+            PROFILE_COUNT(profiler, Counter::Pixels_shaded, 1);
+        }
+    }
+
+    vis_objects.clear();
+    vis_clip_verts.clear();
+    vis_colors.clear();
+    vis_next_id = 1;
+}
+
+// Enable or disable the tiled sample layout
+void Renderer::enable_tiled_layout(bool enable) {
+    tiled = enable;
+    update_render_target();
+}
+
+// Enable or disable visibility buffer rendering of filled objects
+void Renderer::enable_visibility_buffer(bool enable) {
+    visibility = enable;
+    if (visibility) reserve_depth((int)zbuffer.size());
+    vis_objects.clear();
+    vis_clip_verts.clear();
+    vis_colors.clear();
+    vis_next_id = 1;
+}
+
+// Draw lines antialiased instead of with single pixel steps
+void Renderer::enable_aa_lines(bool enable) {
+    aa_lines = enable;
+    scene_valid = false;
+}
+
+// Redraw only damaged rects in frames drawn by render()
+void Renderer::enable_dirty_regions(bool enable) {
+    dirty_regions = enable;
+    scene_valid = false;
+}
+
+// Redraw the whole next frame
+void Renderer::invalidate() {
+    scene_valid = false;
+}
+
+// Enable or disable occlusion culling against marked occluders
+void Renderer::enable_occlusion_culling(bool enable) {
+    occlusion = enable;
+    occlusion_depth.assign(OCCLUSION_WIDTH * OCCLUSION_HEIGHT, std::numeric_limits<float>::infinity());
+}
+
+// Rasterize pixels fully covered by the occluder with their farthest depth, so
+// the buffer never hides anything the full resolution image would show
+void Renderer::rasterize_occluder(const Renderable& obj, const Mat4& mvp) {
+    const Quantized_mesh* quantized = obj.get_quantized();
+    const auto& verts = obj.get_vertices();
+    const auto& inds = obj.get_indices();
+
+    if (quantized) {
+        Mat4 packed_mvp = mvp * quantized->get_dequantize();
+        const auto& packed = quantized->get_positions();
+        occluder_verts.resize(packed.size());
+        for (size_t i = 0; i < packed.size(); ++i) occluder_verts[i] = packed_mvp.transform(packed[i]);
+    } else {
+        occluder_verts.resize(verts.size());
+        for (size_t i = 0; i < verts.size(); ++i) {
+            occluder_verts[i] = mvp.transform(Vec4(verts[i].x, verts[i].y, verts[i].z, 1.0f));
+        }
+    }
+
+    // Quantized indices are walked cluster by cluster
+    const Quantized_mesh::Cluster* cluster = quantized ? quantized->get_clusters().data() : nullptr;
+    size_t count = index_count(obj);
+    for (size_t i = 0; i + 2 < count; i += 3) {
+        uint32_t corner[3];
+        if (cluster) {
+            while (i >= size_t(cluster->first_index) + cluster->index_count) ++cluster;
+            quantized->get_triangle(*cluster, i, corner[0], corner[1], corner[2]);
+        } else {
+            for (int k = 0; k < 3; ++k) corner[k] = inds[i + k];
+        }
+        const Vec4* c[3] = {&occluder_verts[corner[0]], &occluder_verts[corner[1]], &occluder_verts[corner[2]]};
+
+        // Triangles crossing the near plane are skipped, they only ever occlude less
+        int codes[3];
+        bool behind = false;
+        for (int k = 0; k < 3; ++k) {
+            codes[k] = outcode(*c[k]);
+            if (c[k]->w <= 0.0f || (codes[k] & 16)) behind = true;
+        }
+        if (behind || (codes[0] & codes[1] & codes[2])) continue;
+
+        float x[3], y[3], z[3];
+        for (int k = 0; k < 3; ++k) {
+            float inv_w = 1.0f / c[k]->w;
+            x[k] = (c[k]->x * inv_w + 1.0f) * 0.5f * OCCLUSION_WIDTH;
+            y[k] = (1.0f - c[k]->y * inv_w) * 0.5f * OCCLUSION_HEIGHT;
+            z[k] = (c[k]->z * inv_w + 1.0f) * 0.5f;
+        }
+
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+        if (std::fabs(area) < 1e-6f) continue;
+        if (area < 0.0f) {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(z[1], z[2]);
+            area = -area;
+        }
+
+        // Edge functions a * x + b * y + c, a pixel is fully covered when the
+        // value at its center exceeds half the step to its farthest corner
+        float ea[3], eb[3], ec[3], margin[3];
+        for (int k = 0; k < 3; ++k) {
+            int j = (k + 1) % 3;
+            ea[k] = y[k] - y[j];
+            eb[k] = x[j] - x[k];
+            ec[k] = x[k] * y[j] - y[k] * x[j];
+            margin[k] = 0.5f * (std::fabs(ea[k]) + std::fabs(eb[k]));
+        }
+
+        // Depth plane, farthest depth inside a pixel is half a step along both gradients
+        float dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+        float dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+        float dz_margin = 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+        float z_max = std::max(z[0], std::max(z[1], z[2]));
+
+        // Bounds are clamped as floats, vertices outside the side planes may project far away
+        float w = float(OCCLUSION_WIDTH), h = float(OCCLUSION_HEIGHT);
+        int min_x = int(std::clamp(std::floor(std::min(x[0], std::min(x[1], x[2]))), 0.0f, w));
+        int max_x = int(std::clamp(std::ceil(std::max(x[0], std::max(x[1], x[2]))), -1.0f, w - 1.0f));
+        int min_y = int(std::clamp(std::floor(std::min(y[0], std::min(y[1], y[2]))), 0.0f, h));
+        int max_y = int(std::clamp(std::ceil(std::max(y[0], std::max(y[1], y[2]))), -1.0f, h - 1.0f));
+
+        for (int py = min_y; py <= max_y; ++py) {
+            float cy = py + 0.5f;
+            float* row = &occlusion_depth[py * OCCLUSION_WIDTH];
+            for (int px = min_x; px <= max_x; ++px) {
+                float cx = px + 0.5f;
+                if (ea[0] * cx + eb[0] * cy + ec[0] < margin[0]) continue;
+                if (ea[1] * cx + eb[1] * cy + ec[1] < margin[1]) continue;
+                if (ea[2] * cx + eb[2] * cy + ec[2] < margin[2]) continue;
+
+                float depth = std::min(z_max, z[0] + dzdx * (cx - x[0]) + dzdy * (cy - y[0]) + dz_margin);
+                if (depth < row[px]) row[px] = depth;
             }
         }
     }
 }
 
+// True if the projected bounds lie behind the occlusion buffer everywhere
+bool Renderer::occluded(const Aabb& bounds, const Mat4& mvp) const {
+    if (bounds.empty()) return false;
+
+    float min_x = INFINITY, max_x = -INFINITY, min_y = INFINITY, max_y = -INFINITY, min_z = INFINITY;
+    for (int i = 0; i < 8; ++i) {
+        Vec3 p = bounds.corner(i);
+        Vec4 c = mvp.transform(Vec4(p.x, p.y, p.z, 1.0f));
+
+        // Bounds reaching the near plane are never culled
+        if (c.w <= 0.0f || c.z < -c.w) return false;
+
+        float inv_w = 1.0f / c.w;
+        float x = (c.x * inv_w + 1.0f) * 0.5f * OCCLUSION_WIDTH;
+        float y = (1.0f - c.y * inv_w) * 0.5f * OCCLUSION_HEIGHT;
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+        min_z = std::min(min_z, (c.z * inv_w + 1.0f) * 0.5f);
+    }
+
+    // Off screen objects are left to clipping
+    float w = float(OCCLUSION_WIDTH), h = float(OCCLUSION_HEIGHT);
+    int x0 = int(std::clamp(std::floor(min_x), 0.0f, w));
+    int x1 = int(std::clamp(std::floor(max_x), -1.0f, w - 1.0f));
+    int y0 = int(std::clamp(std::floor(min_y), 0.0f, h));
+    int y1 = int(std::clamp(std::floor(max_y), -1.0f, h - 1.0f));
+    if (x0 > x1 || y0 > y1) return false;
+
+    for (int py = y0; py <= y1; ++py) {
+        const float* row = &occlusion_depth[py * OCCLUSION_WIDTH];
+        for (int px = x0; px <= x1; ++px) {
+            if (row[px] >= min_z) return false;
+        }
+    }
+
+    return true;
+}
+
 // SETTERS
 
 // Set camera position and direction
@@ -334,6 +1963,66 @@ void Renderer::set_projection(float fov, float nearZ, float farZ) {
     projection = Mat4::perspective(fov, aspect, nearZ, farZ);
 }
 
+// Set camera matrix directly
+void Renderer::set_view_matrix(const Mat4& _view) {
+    view = _view;
+}
+
+// Set projection matrix directly
+void Renderer::set_projection_matrix(const Mat4& _projection) {
+    projection = _projection;
+}
+
+// Set views rendered in one pass, empty for the single camera
+void Renderer::set_views(const std::vector<View>& _views) {
+    views = _views;
+}
+
+// Viewport of a view scaled from window pixels to the render target, clamped to it
+Renderer::Rect Renderer::target_viewport(const View& v) const {
+    int target_width = ssaa ? ssaa_width : width;
+    int target_height = ssaa ? ssaa_height : height;
+    auto scale = [](int value, int from, int to) { return int(int64_t(value) * to / from); };
+
+    Rect rect;
+    rect.x0 = std::clamp(scale(v.x, width, target_width), 0, target_width);
+    rect.y0 = std::clamp(scale(v.y, height, target_height), 0, target_height);
+    rect.x1 = std::clamp(scale(v.x + v.width, width, target_width), rect.x0, target_width);
+    rect.y1 = std::clamp(scale(v.y + v.height, height, target_height), rect.y0, target_height);
+    return rect;
+}
+
+// True if bounds lie outside one clip plane of mvp, every triangle would be rejected
+bool Renderer::outside_frustum(const Aabb& bounds, const Mat4& mvp) {
+    if (bounds.empty()) return false;
+
+    int code = ~0;
+    for (int i = 0; i < 8 && code; ++i) {
+        Vec3 p = bounds.corner(i);
+        code &= outcode(mvp.transform(Vec4(p.x, p.y, p.z, 1.0f)));
+    }
+    return code != 0;
+}
+
+// Set mode used by render()
+void Renderer::set_render_mode(Render_mode mode) {
+    render_mode = mode;
+}
+
+// Set shading of filled objects
+void Renderer::set_shade_mode(Shade_mode mode) {
+    shade_mode = mode;
+}
+
+// Set world space light direction and ambient light
+void Renderer::set_light(const Vec3& direction, float _ambient) {
+    Vec3 dir = direction.norm();
+    _ambient = clamp(_ambient, 0.0f, 1.0f);
+    if (dir.x != light_dir.x || dir.y != light_dir.y || dir.z != light_dir.z || _ambient != ambient) scene_valid = false;
+    light_dir = dir;
+    ambient = _ambient;
+}
+
 // CLIP PLANE
 // Check if inside clip plane
 bool Renderer::inside(const Vec4& v, Renderer::Clip_plane plane) {
@@ -351,6 +2040,12 @@ bool Renderer::inside(const Vec4& v, Renderer::Clip_plane plane) {
 
 // Interpolate clipping
 Vec4 Renderer::interpolate(const Vec4& a, const Vec4& b, Renderer::Clip_plane plane) {
+    float t = intersect(a, b, plane);
+    return a + (b - a) * t;
+}
+
+// Position of the clip plane crossing along a to b
+float Renderer::intersect(const Vec4& a, const Vec4& b, Renderer::Clip_plane plane) {
     float t_num = 0.0f;
     float t_den = 1.0f;
 
@@ -382,62 +2077,182 @@ Vec4 Renderer::interpolate(const Vec4& a, const Vec4& b, Renderer::Clip_plane pl
     }
 
     // Prevent division by near zero
-    if (fabs(t_den) < 1e-6f) return a;
+    if (fabs(t_den) < 1e-6f) return 0.0f;
 
     float t = t_num / t_den;
     if (t < 0.0f) t = 0.0f;
     if (t > 1.0f) t = 1.0f;
-    return a + (b - a) * t;
+    return t;
 }
 
 // Clip polygon against a single plane
-std::vector<Vec4> Renderer::clip_poly(const std::vector<Vec4>& vertices, Renderer::Clip_plane plane) {
-    std::vector<Vec4> output;
+std::vector<Renderer::Clip_vertex> Renderer::clip_poly(const std::vector<Clip_vertex>& vertices, Renderer::Clip_plane plane) {
+    // Every input vertex adds at most two, whatever rounding does to the crossings
+    std::vector<Clip_vertex> output(2 * vertices.size());
+    output.resize(clip_poly(vertices.data(), vertices.size(), output.data(), output.size(), plane));
+    return output;
+
+}
+
+// Clip polygon against a single plane into out, which holds capacity vertices.
+// Rounding on extreme coordinates can produce more vertices than exact
+// arithmetic allows, such polygons are dropped and 0 is returned.
+size_t Renderer::clip_poly(const Clip_vertex* vertices, size_t count, Clip_vertex* out, size_t capacity,
+                           Renderer::Clip_plane plane) {
+    size_t written = 0;
+
+    // Crossing of the plane along edge i to j
+    auto crossing = [&](const Clip_vertex& a, const Clip_vertex& b) {
+        float t = intersect(a.pos, b.pos, plane);
+        return Clip_vertex{a.pos + (b.pos - a.pos) * t, a.weights + (b.weights - a.weights) * t};
+    };
 
-    for (size_t i = 0; i < vertices.size(); ++i) {
-        size_t j = (i + 1) % vertices.size();
-        bool inside_i = inside(vertices[i], plane);
-        bool inside_j = inside(vertices[j], plane);
+    for (size_t i = 0; i < count; ++i) {
+        size_t j = (i + 1) % count;
+        bool inside_i = inside(vertices[i].pos, plane);
+        bool inside_j = inside(vertices[j].pos, plane);
 
-        if (inside_i && inside_j) output.push_back(vertices[j]);
+        size_t added = inside_j ? (inside_i ? 1 : 2) : (inside_i ? 1 : 0);
+        if (written + added > capacity) return 0;
+
+        if (inside_i && inside_j) out[written++] = vertices[j];
         else if (inside_i && !inside_j) {
-            Vec4 clipped_point = interpolate(vertices[i], vertices[j], plane);
-            output.push_back(clipped_point);
+            out[written++] = crossing(vertices[i], vertices[j]);
         } else if (!inside_i && inside_j) {
-            Vec4 clipped_point = interpolate(vertices[i], vertices[j], plane);
-            output.push_back(clipped_point);
-            output.push_back(vertices[j]);
+            out[written++] = crossing(vertices[i], vertices[j]);
+            out[written++] = vertices[j];
         }
 
     }
     
-    return output;
+    return written;
 
 }
 
 std::vector<std::array<Vec4, 3>> Renderer::clip_triangle(const std::array<Vec4, 3>& triangle) {
-    std::vector<Vec4> vertices = {triangle[0], triangle[1], triangle[2]};
+    auto weighted = clip_triangle_weighted(triangle);
 
-    // Clip against all 6 planes sequentially
-    vertices = clip_poly(vertices, Clip_plane::Left);
-    if (vertices.empty()) return {};
-    vertices = clip_poly(vertices, Clip_plane::Right);
-    if (vertices.empty()) return {};
-    vertices = clip_poly(vertices, Clip_plane::Bottom);
-    if (vertices.empty()) return {};
-    vertices = clip_poly(vertices, Clip_plane::Top);
-    if (vertices.empty()) return {};
-    vertices = clip_poly(vertices, Clip_plane::Near);
-    if (vertices.empty()) return {};
-    vertices = clip_poly(vertices, Clip_plane::Far);
-    if (vertices.empty()) return {};
+    std::vector<std::array<Vec4, 3>> output;
+    output.reserve(weighted.size());
+    for (const auto& t : weighted) {
+        output.push_back({t[0].pos, t[1].pos, t[2].pos});
+    }
+
+    return output;
+
+}
+
+// Clip triangles, keeps vertex weights for attribute interpolation
+std::vector<std::array<Renderer::Clip_vertex, 3>> Renderer::clip_triangle_weighted(const std::array<Vec4, 3>& triangle) {
+    Clip_vertex a{triangle[0], Vec3(1, 0, 0)};
+    Clip_vertex b{triangle[1], Vec3(0, 1, 0)};
+    Clip_vertex c{triangle[2], Vec3(0, 0, 1)};
+
+    int code0 = outcode(triangle[0]);
+    int code1 = outcode(triangle[1]);
+    int code2 = outcode(triangle[2]);
+
+    // All vertices outside the same plane, reject trivially
+    if (code0 & code1 & code2) {
+        PROFILE_COUNT(profiler, Counter::Triangles_rejected, 1);
+        return {};
+    }
+
+    // All vertices inside every plane, nothing to clip
+    if ((code0 | code1 | code2) == 0) return {{a, b, c}};
+
+    PROFILE_COUNT(profiler, Counter::Triangles_clipped, 1);
+
+    Clip_vertex scratch[2 * MAX_CLIP_VERTICES];
+    size_t count;
+    const Clip_vertex* vertices = clip_planes(triangle, scratch, count);
 
     // Triangulate resulting polygon (fan triangulation)
-    std::vector<std::array<Vec4, 3>> output;
-    for (size_t i = 1; i + 1 < vertices.size(); ++i) {
+    std::vector<std::array<Clip_vertex, 3>> output;
+    for (size_t i = 1; i + 1 < count; ++i) {
         output.push_back({vertices[0], vertices[i], vertices[i + 1]});
     }
 
     return output;
 
-}
\ No newline at end of file
+}
+
+// Clip triangle against all planes, ping pongs between the two halves of
+// scratch and returns the polygon with count vertices, count is 0 if nothing is left
+const Renderer::Clip_vertex* Renderer::clip_planes(const std::array<Vec4, 3>& triangle, Clip_vertex* scratch, size_t& count) {
+    Clip_vertex* in = scratch;
+    Clip_vertex* out = scratch + MAX_CLIP_VERTICES;
+    in[0] = {triangle[0], Vec3(1, 0, 0)};
+    in[1] = {triangle[1], Vec3(0, 1, 0)};
+    in[2] = {triangle[2], Vec3(0, 0, 1)};
+    count = 3;
+
+    // Clip against all 6 planes sequentially
+    static const Clip_plane planes[] = {
+        Clip_plane::Left, Clip_plane::Right, Clip_plane::Bottom,
+        Clip_plane::Top, Clip_plane::Near, Clip_plane::Far
+    };
+    for (Clip_plane plane : planes) {
+        count = clip_poly(in, count, out, MAX_CLIP_VERTICES, plane);
+        if (count == 0) return in;
+        std::swap(in, out);
+    }
+
+    return in;
+
+}
+
+// Bit mask of clip planes a vertex is outside of
+int Renderer::outcode(const Vec4& v) {
+    int code = 0;
+    if (v.x < -v.w) code |= 1;
+    if (v.x > v.w)  code |= 2;
+    if (v.y < -v.w) code |= 4;
+    if (v.y > v.w)  code |= 8;
+    if (v.z < -v.w) code |= 16;
+    if (v.z > v.w)  code |= 32;
+    return code;
+}
+
+// PROFILING
+
+// Statistics of the last presented frame
+const Frame_stats& Renderer::get_stats() const {
+#ifdef POLYRENDER_PROFILE
+    return profiler.last_frame();
+#else
+    static const Frame_stats empty;
+    return empty;
+#endif
+}
+
+// Stream per frame statistics to a CSV file
+bool Renderer::open_stats_csv(const std::string& path) {
+#ifdef POLYRENDER_PROFILE
+    return profiler.open_csv(path);
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// Show depth complexity heatmaps instead of colors
+bool Renderer::enable_overdraw(bool enable) {
+#ifdef POLYRENDER_OVERDRAW
+    overdraw.set_enabled(enable);
+    if (enable) overdraw.clear(zbuffer.size());
+    overdraw_stats = Overdraw_stats();
+    scene_valid = false;
+    return true;
+#else
+    (void)enable;
+    return false;
+#endif
+}
+
+// Stop streaming statistics
+void Renderer::close_stats_csv() {
+#ifdef POLYRENDER_PROFILE
+    profiler.close_csv();
+#endif
+}
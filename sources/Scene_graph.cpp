@@ -0,0 +1,161 @@
+#include "Scene_graph.hpp"
+
+#include <algorithm>
+
+// Add node as last child of parent. The node is appended, which keeps every
+// subtree contiguous when the parent's subtree ends the arrays. Otherwise the
+// arrays are out of depth first order until update() reorders them once, so
+// building a graph in any order costs linear time.
+Scene_graph::Node Scene_graph::add_node(Node parent_node, const Mat4& local_matrix) {
+    Node node = Node(index_of.size());
+    uint32_t parent_pos = parent_node == NONE ? NONE : index_of[parent_node];
+    uint32_t pos = uint32_t(parent.size());
+
+    // Ancestors grow by the new node while it extends their subtrees
+    if (ordered && parent_pos != NONE && subtree_end[parent_pos] != pos) ordered = false;
+    if (ordered) {
+        for (uint32_t a = parent_pos; a != NONE; a = parent[a]) subtree_end[a]++;
+    }
+
+    parent.push_back(parent_pos);
+    subtree_end.push_back(pos + 1);
+    local.push_back(local_matrix);
+    world.push_back(Mat4::identity());
+    mesh.push_back(nullptr);
+    state.push_back(Draw_state());
+    node_at.push_back(node);
+
+    index_of.push_back(pos);
+    is_dirty.push_back(0);
+    mark_dirty(node);
+    return node;
+}
+
+// Remove all nodes
+void Scene_graph::clear() {
+    parent.clear();
+    subtree_end.clear();
+    local.clear();
+    world.clear();
+    mesh.clear();
+    state.clear();
+    node_at.clear();
+    index_of.clear();
+    dirty.clear();
+    is_dirty.clear();
+    updated = 0;
+    ordered = true;
+}
+
+// Set local transform relative to the parent
+void Scene_graph::set_local(Node node, const Mat4& local_matrix) {
+    local[index_of[node]] = local_matrix;
+    mark_dirty(node);
+}
+
+// Attach mesh drawn with the world matrix of node
+void Scene_graph::set_mesh(Node node, const Renderable* _mesh, Draw_state _state) {
+    mesh[index_of[node]] = _mesh;
+    state[index_of[node]] = _state;
+}
+
+// Parent of node, NONE for roots
+Scene_graph::Node Scene_graph::get_parent(Node node) const {
+    uint32_t p = parent[index_of[node]];
+    return p == NONE ? NONE : node_at[p];
+}
+
+// Recompute world matrices of dirty subtrees. Dirty positions are sorted so a
+// subtree containing other dirty nodes is walked once and covers them.
+void Scene_graph::update() {
+    updated = 0;
+    if (dirty.empty()) return;
+    if (!ordered) reorder();
+
+    dirty_index.clear();
+    for (Node node : dirty) {
+        dirty_index.push_back(index_of[node]);
+        is_dirty[node] = 0;
+    }
+    dirty.clear();
+    std::sort(dirty_index.begin(), dirty_index.end());
+
+    uint32_t covered = 0;
+    for (uint32_t root : dirty_index) {
+        if (root < covered) continue;
+
+        uint32_t end = subtree_end[root];
+        for (uint32_t i = root; i < end; ++i) {
+            world[i] = parent[i] == NONE ? local[i] : world[parent[i]] * local[i];
+        }
+        updated += end - root;
+        covered = end;
+    }
+}
+
+// Restore depth first order after out of order insertions. Children keep the
+// order they were added in, which is their position order.
+void Scene_graph::reorder() {
+    uint32_t count = uint32_t(parent.size());
+
+    // Children of each position, in position order
+    std::vector<uint32_t> first_child(count + 1, 0), children(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parent[i] != NONE) first_child[parent[i] + 1]++;
+    }
+    for (uint32_t i = 0; i < count; ++i) first_child[i + 1] += first_child[i];
+    std::vector<uint32_t> fill(first_child.begin(), first_child.end() - 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parent[i] != NONE) children[fill[parent[i]]++] = i;
+    }
+
+    // Depth first walk, order[new position] = old position
+    std::vector<uint32_t> order, stack, new_pos(count);
+    order.reserve(count);
+    for (uint32_t i = count; i-- > 0;) {
+        if (parent[i] == NONE) stack.push_back(i);
+    }
+    while (!stack.empty()) {
+        uint32_t pos = stack.back();
+        stack.pop_back();
+        new_pos[pos] = uint32_t(order.size());
+        order.push_back(pos);
+        for (uint32_t c = first_child[pos + 1]; c-- > first_child[pos];) stack.push_back(children[c]);
+    }
+
+    auto permute = [&order](auto& values) {
+        auto old = values;
+        for (size_t i = 0; i < order.size(); ++i) values[i] = old[order[i]];
+    };
+    permute(parent);
+    permute(local);
+    permute(world);
+    permute(mesh);
+    permute(state);
+    permute(node_at);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (parent[i] != NONE) parent[i] = new_pos[parent[i]];
+        index_of[node_at[i]] = i;
+    }
+
+    // Subtrees end after their last descendant, children come after their parent
+    for (uint32_t i = 0; i < count; ++i) subtree_end[i] = i + 1;
+    for (uint32_t i = count; i-- > 0;) {
+        if (parent[i] != NONE) subtree_end[parent[i]] = std::max(subtree_end[parent[i]], subtree_end[i]);
+    }
+    ordered = true;
+}
+
+// Record draws of every node with a mesh
+void Scene_graph::record(Command_list& list) const {
+    for (size_t i = 0; i < parent.size(); ++i) {
+        if (mesh[i]) list.draw(*mesh[i], world[i], state[i]);
+    }
+}
+
+// Mark node dirty once
+void Scene_graph::mark_dirty(Node node) {
+    if (is_dirty[node]) return;
+    is_dirty[node] = 1;
+    dirty.push_back(node);
+}
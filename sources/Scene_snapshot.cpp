@@ -0,0 +1,19 @@
+#include "Scene_snapshot.hpp"
+
+// Publish back as the latest snapshot. The exchange releases the writes to
+// back and hands over whichever snapshot was in the middle.
+void Snapshot_buffer::publish() {
+    slots[back_index].snapshot.sequence = ++published;
+    uint32_t old = middle.exchange(back_index | FRESH, std::memory_order_acq_rel);
+    back_index = old & ~FRESH;
+}
+
+// Latest published snapshot. Without a new publish the front is kept, otherwise
+// it is swapped with the middle, which acquires the writes of its publish.
+const Scene_snapshot& Snapshot_buffer::acquire() {
+    if (middle.load(std::memory_order_relaxed) & FRESH) {
+        uint32_t old = middle.exchange(front_index, std::memory_order_acq_rel);
+        front_index = old & ~FRESH;
+    }
+    return slots[front_index].snapshot;
+}
@@ -1,13 +1,17 @@
 #include "Sphere.hpp"
 
-Sphere::Sphere(float radius, int latSegments, int longSegments) {
-    generate_mesh(radius, latSegments, longSegments);
-}
-
-// Generates vertices and indices for sphere mesh
-void Sphere::generate_mesh(float radius, int latSegments, int longSegments) {
-    vertices.clear();
-    indices.clear();
+Sphere::Sphere(float radius, int latSegments, int longSegments) :
+    mesh(Mesh_cache::get({Mesh_shape::Sphere, radius, {latSegments, longSegments}},
+                         [=] { return generate_mesh(radius, latSegments, longSegments); })),
+    radius(radius) {}
+
+// Generates vertices, normals, texture coordinates and indices for sphere mesh
+Mesh_data Sphere::generate_mesh(float radius, int latSegments, int longSegments) {
+    Mesh_data data;
+    std::vector<Vec3>& vertices = data.vertices;
+    std::vector<uint32_t>& indices = data.indices;
+    std::vector<Vec3>& normals = data.normals;
+    std::vector<Vec2>& uvs = data.uvs;
 
     // Generate vertices
     for (int lat = 0; lat <= latSegments; ++lat) {
@@ -25,6 +29,8 @@ void Sphere::generate_mesh(float radius, int latSegments, int longSegments) {
             float z = radius * sinTheta * sinPhi;
 
             vertices.emplace_back(x, y, z);
+            normals.emplace_back(sinTheta * cosPhi, cosTheta, sinTheta * sinPhi);
+            uvs.emplace_back(float(lon) / longSegments, float(lat) / latSegments);
         }
     }
 
@@ -44,17 +50,18 @@ void Sphere::generate_mesh(float radius, int latSegments, int longSegments) {
             indices.push_back(first + 1);
         }
     }
+    return data;
 }
 
 // GETTERS
 // Returns vector<Vec3> with vertices
 const std::vector<Vec3>& Sphere::get_vertices() const {
-    return vertices;
+    return mesh->vertices;
 }
 
 // Returns vector<uint32_t> with indices
 const std::vector<uint32_t>& Sphere::get_indices() const {
-    return indices;
+    return mesh->indices;
 }
 
 // Returns Mat4 with model matrix
@@ -68,6 +75,26 @@ const Mat4 Sphere::get_model_matrix() const {
     return T * Rz * Ry * Rx * S;
 }
 
+// Returns ARGB fill color
+uint32_t Sphere::get_color() const {
+    return color;
+}
+
+// Returns bounds of the sphere radius
+Aabb Sphere::get_bounds() const {
+    return Aabb(Vec3(-radius, -radius, -radius), Vec3(radius, radius, radius));
+}
+
+// Returns vector<Vec3> with per vertex normals
+const std::vector<Vec3>& Sphere::get_normals() const {
+    return mesh->normals;
+}
+
+// Returns vector<Vec2> with longitude and latitude texture coordinates
+const std::vector<Vec2>& Sphere::get_uvs() const {
+    return mesh->uvs;
+}
+
 // SETTERS
 // Set position Vec3 {x, y, z}
 void Sphere::set_position(const Vec3& _pos) {
@@ -82,4 +109,9 @@ void Sphere::set_rotation(const Vec3& _rot) {
 // Set scale Vec3 {scale x, scale y, scale z}
 void Sphere::set_scale(const Vec3& _scale) {
     scale = _scale;
-}
\ No newline at end of file
+}
+
+// Set ARGB fill color
+void Sphere::set_color(uint32_t _color) {
+    color = _color;
+}
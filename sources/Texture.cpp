@@ -0,0 +1,160 @@
+#include "Texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Coordinates beyond this have no fraction left and are treated as 0, like NaN
+static constexpr float COORD_LIMIT = 8388608.0f;
+
+// Floor of a texel coordinate
+static inline int floor_coord(float f) {
+    if (!(f > -COORD_LIMIT && f < COORD_LIMIT)) return 0;
+    int i = int(f);
+    return i - (f < float(i));
+}
+
+// Texel coordinate repeated into [0, size)
+static inline int repeat(int i, int size) {
+    if (unsigned(i) < unsigned(size)) return i;
+    i %= size;
+    return i < 0 ? i + size : i;
+}
+
+// Blend two ARGB texels by t in [0, 256], two channels per multiply
+static inline uint32_t lerp_texel(uint32_t a, uint32_t b, uint32_t t) {
+    uint32_t rb = ((a & 0x00FF00FF) * (256 - t) + (b & 0x00FF00FF) * t) >> 8 & 0x00FF00FF;
+    uint32_t ag = (((a >> 8) & 0x00FF00FF) * (256 - t) + ((b >> 8) & 0x00FF00FF) * t) & 0xFF00FF00;
+    return rb | ag;
+}
+
+// Average of four ARGB texels
+static inline uint32_t average_texels(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = (a >> shift & 0xFF) + (b >> shift & 0xFF) + (c >> shift & 0xFF) + (d >> shift & 0xFF);
+        result |= ((sum + 2) >> 2) << shift;
+    }
+    return result;
+}
+
+Texture::Texture(int width, int height, const std::vector<uint32_t>& rows) {
+    if (width <= 0 || height <= 0 || rows.size() != size_t(width) * height) return;
+
+    // Level sizes halve down to 1x1, each level starts on a whole tile
+    std::vector<size_t> offsets;
+    size_t total = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        Level level;
+        level.width = w;
+        level.height = h;
+        level.scale_x = float(w);
+        level.scale_y = float(h);
+        levels.push_back(std::move(level));
+        offsets.push_back(total);
+        int tiles_x = (w + TILE_SIZE - 1) / TILE_SIZE, tiles_y = (h + TILE_SIZE - 1) / TILE_SIZE;
+        total += size_t(tiles_x) * tiles_y * TILE_SIZE * TILE_SIZE;
+        if (w == 1 && h == 1) break;
+    }
+
+    // Storage starts on a cache line, offsets include the padding in front of it
+    texels.resize(total + ALIGNMENT - 1, 0);
+    size_t misalignment = (reinterpret_cast<uintptr_t>(texels.data()) / sizeof(uint32_t)) % ALIGNMENT;
+    size_t base = misalignment ? ALIGNMENT - misalignment : 0;
+
+    for (size_t i = 0; i < levels.size(); ++i) {
+        Level& l = levels[i];
+        size_t tile_row = size_t((l.width + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE * TILE_SIZE;
+        l.col_offset.resize(l.width);
+        l.row_offset.resize(l.height);
+        for (int x = 0; x < l.width; ++x) {
+            l.col_offset[x] = uint32_t(size_t(x / TILE_SIZE) * TILE_SIZE * TILE_SIZE + ((x & 1) | (x & 2) << 1));
+        }
+        for (int y = 0; y < l.height; ++y) {
+            l.row_offset[y] = uint32_t(base + offsets[i] + size_t(y / TILE_SIZE) * tile_row + ((y & 1) << 1 | (y & 2) << 2));
+        }
+    }
+
+    // Each level is the 2x2 box filtered level above, odd edges repeat their last texel
+    store_level(0, rows.data());
+    std::vector<uint32_t> above = rows, below;
+    for (size_t i = 1; i < levels.size(); ++i) {
+        const Level& src = levels[i - 1];
+        const Level& dst = levels[i];
+        below.resize(size_t(dst.width) * dst.height);
+        for (int y = 0; y < dst.height; ++y) {
+            const uint32_t* row0 = &above[size_t(std::min(2 * y, src.height - 1)) * src.width];
+            const uint32_t* row1 = &above[size_t(std::min(2 * y + 1, src.height - 1)) * src.width];
+            for (int x = 0; x < dst.width; ++x) {
+                int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+                below[size_t(y) * dst.width + x] = average_texels(row0[x0], row0[x1], row1[x0], row1[x1]);
+            }
+        }
+        store_level(int(i), below.data());
+        std::swap(above, below);
+    }
+}
+
+// size x size checkerboard of cells x cells squares
+Texture Texture::checkerboard(int size, int cells, uint32_t color0, uint32_t color1) {
+    if (size <= 0) return Texture();
+    int cell = std::max(1, size / std::max(1, cells));
+    std::vector<uint32_t> rows(size_t(size) * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) rows[size_t(y) * size + x] = ((x / cell + y / cell) & 1) ? color1 : color0;
+    }
+    return Texture(size, size, rows);
+}
+
+// Store a level of width x height texels in rows into its tiles
+void Texture::store_level(int level, const uint32_t* rows) {
+    const Level& l = levels[level];
+    for (int y = 0; y < l.height; ++y) {
+        for (int x = 0; x < l.width; ++x) texels[l.row_offset[y] + l.col_offset[x]] = rows[size_t(y) * l.width + x];
+    }
+}
+
+// Level whose texels are closest to one per sample, level 0 when magnified
+int Texture::select_level(float texel_area, float sample_area) const {
+    int last = int(levels.size()) - 1;
+    if (last <= 0 || !(texel_area > sample_area)) return 0;
+
+    float ratio = texel_area / sample_area;
+    if (!(ratio < 1e30f)) return last;
+    int level = int(0.5f * std::log2(ratio) + 0.5f);
+    return std::min(level, last);
+}
+
+// Texel of a level containing u, v
+uint32_t Texture::sample_nearest(int level, float u, float v) const {
+    const Level& l = levels[level];
+    int x = repeat(floor_coord(u * l.scale_x), l.width);
+    int y = repeat(floor_coord(v * l.scale_y), l.height);
+    return texels[l.row_offset[y] + l.col_offset[x]];
+}
+
+// Bilinear blend of the 2x2 texels of a level around u, v, weights in 1/256 steps
+uint32_t Texture::sample_bilinear(int level, float u, float v) const {
+    const Level& l = levels[level];
+    float fx = u * l.scale_x - 0.5f, fy = v * l.scale_y - 0.5f;
+    int ix = floor_coord(fx), iy = floor_coord(fy);
+    uint32_t wx = uint32_t(std::min(std::max(0.0f, fx - float(ix)), 1.0f) * 256.0f);
+    uint32_t wy = uint32_t(std::min(std::max(0.0f, fy - float(iy)), 1.0f) * 256.0f);
+
+    int x0 = repeat(ix, l.width), y0 = repeat(iy, l.height);
+    int x1 = x0 + 1 == l.width ? 0 : x0 + 1;
+    int y1 = y0 + 1 == l.height ? 0 : y0 + 1;
+
+    const uint32_t* row0 = texels.data() + l.row_offset[y0];
+    const uint32_t* row1 = texels.data() + l.row_offset[y1];
+    uint32_t col0 = l.col_offset[x0], col1 = l.col_offset[x1];
+    uint32_t top = lerp_texel(row0[col0], row0[col1], wx);
+    uint32_t bottom = lerp_texel(row1[col0], row1[col1], wx);
+    return lerp_texel(top, bottom, wy);
+}
+
+// SETTERS
+// Set filter used by sample()
+void Texture::set_filter(Filter _filter) {
+    filter = _filter;
+}
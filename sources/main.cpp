@@ -2,40 +2,131 @@
 #include "Cube.hpp"
 #include "Sphere.hpp"
 #include "Render_math.hpp"
+#include "Capture.hpp"
+#include "Frame_controller.hpp"
+#include "Scene_snapshot.hpp"
+#include "Texture.hpp"
 
 #include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
 
 const int WIDTH = 640;
 const int HEIGHT = 480;
 
-int main() {
+int main(int argc, char** argv) {
+    // Optional capture of every frame: --capture <file> [--frames N] [--filled]
+    // --threaded-update simulates on its own thread and renders its snapshots
+    // --textured draws the cube filled with a checkerboard texture
+    const char* capture_path = nullptr;
+    long max_frames = -1;
+    bool filled = false;
+    bool threaded_update = false;
+    bool textured = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) capture_path = argv[++i];
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) max_frames = std::atol(argv[++i]);
+        else if (std::strcmp(argv[i], "--filled") == 0) filled = true;
+        else if (std::strcmp(argv[i], "--threaded-update") == 0) threaded_update = true;
+        else if (std::strcmp(argv[i], "--textured") == 0) textured = filled = true;
+    }
+    if (capture_path && threaded_update) {
+        std::cerr << "[Error] --capture reads the scene objects and can't be combined with --threaded-update\n";
+        return 1;
+    }
+
     Renderer renderer(640, 480);
     renderer.init_x11();
-    renderer.enable_ssaa(1);
 
     renderer.set_camera(Vec3(0, 0, 5), Vec3(0, 0, 0), Vec3(0, 1, 0));
     renderer.set_projection(3.14159f / 3.0f, 0.1f, 100.0f);
+    if (filled) renderer.set_render_mode(Renderer::Render_mode::Filled);
 
     Cube cube;
     cube.set_scale({1.0f, 1.0f, 1.0f});
+    cube.set_color(0xFFFF8040);
+    Texture checker = Texture::checkerboard(256, 8, 0xFFFFFFFF, 0xFF606060);
+    if (textured) cube.set_texture(&checker);
     //Sphere sphere(1.0f, 16, 16);
 
     renderer.add_object(&cube);
     //renderer.add_object(&sphere);
+
+    Capture_writer capture;
+    if (capture_path && !capture.open(capture_path, renderer)) {
+        std::cerr << "[Error] Could not open capture file " << capture_path << "\n";
+        return 1;
+    }
     
+    // Hold a 16 ms frame budget by scaling resolution and SSAA
+    Frame_controller controller(16.0);
+    controller.reserve(renderer);
+    controller.apply(renderer);
+
     float angle = 0;
 
-    while(true) {
-        cube.set_rotation(Vec3(-angle, -angle, 0));
-        //sphere.set_rotation(Vec3(0, -angle, 0));
-        renderer.render_wireframes();
+    // Simulation at a fixed 240 Hz, independent of the frame rate. Only this
+    // thread touches the cube's transform, the renderer reads the snapshots.
+    Snapshot_buffer snapshots;
+    std::atomic<bool> running{true};
+    std::thread update;
+    if (threaded_update) {
+        // Renderer state is read before the thread starts, the render loop owns the renderer
+        Renderer::Render_mode mode = renderer.get_render_mode();
+        Renderer::Shade_mode shade = renderer.get_shade_mode();
+        Mat4 view = renderer.get_view_matrix();
+        update = std::thread([&snapshots, &running, &cube, mode, shade, view] {
+            auto begin = std::chrono::steady_clock::now();
+            while (running.load(std::memory_order_relaxed)) {
+                float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - begin).count();
+                float angle = seconds * 0.3f;
+                cube.set_rotation(Vec3(-angle, -angle, 0));
+
+                Scene_snapshot& snapshot = snapshots.back();
+                snapshot.items.clear();
+                snapshot.items.push_back({&cube, cube.get_model_matrix(), mode, shade});
+                snapshot.view = view;
+                snapshots.publish();
+                usleep(1000000 / 240);
+            }
+        });
+    }
+
+    for (long frame = 0; max_frames < 0 || frame < max_frames; ++frame) {
+        auto start = std::chrono::steady_clock::now();
+
+        if (threaded_update) {
+            // Nothing to draw until the update thread publishes its first snapshot
+            const Scene_snapshot& snapshot = snapshots.acquire();
+            if (snapshot.sequence != 0) {
+                renderer.set_view_matrix(snapshot.view);
+                renderer.render_batch(snapshot.items);
+            }
+        } else {
+            cube.set_rotation(Vec3(-angle, -angle, 0));
+            //sphere.set_rotation(Vec3(0, -angle, 0));
+            capture.record_frame(renderer);
+            renderer.render();
+        }
         renderer.show();
-        usleep(16000);
+
+        // Sleep for what is left of the budget
+        double frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (frame_ms < controller.get_target_ms()) usleep(useconds_t((controller.get_target_ms() - frame_ms) * 1000.0));
+
+        if (controller.update(frame_ms)) controller.apply(renderer);
         renderer.clear(0xff000000);
         angle += 0.005f;
         
     }
 
+    if (update.joinable()) {
+        running.store(false, std::memory_order_relaxed);
+        update.join();
+    }
+
     return 0;
 }
-
@@ -0,0 +1,509 @@
+// End to end benchmark of canned scenes. Every scene renders headless for a
+// fixed number of frames, reports frames per second and per stage times, and
+// hashes its frames against golden hashes so optimizations can be shown both
+// faster and pixel identical.
+//
+// Usage: Polyrender_bench [--scene <name>] [--threads N] [--tiled] [--dirty] [--golden <file>] [--update]
+//                         [--images <dir>] [--tolerance N]
+//
+// --update rewrites the golden file, with --images the last frame of every
+// scene is stored too. A scene whose hash differs still passes if its last
+// frame is within --tolerance of the stored image on every channel. --tiled
+// renders with the tiled sample layout and --dirty redraws only dirty regions,
+// both must match the same goldens.
+
+#include "Renderer.hpp"
+#include "Cube.hpp"
+#include "Sphere.hpp"
+#include "Point_cloud.hpp"
+#include "Texture.hpp"
+#include "Scene_graph.hpp"
+#include "Command_buffer.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifndef POLYRENDER_BENCH_GOLDEN
+#define POLYRENDER_BENCH_GOLDEN "bench_golden.txt"
+#endif
+
+static const int WIDTH = 640;
+static const int HEIGHT = 480;
+
+// Objects of a scene, kept alive while it renders. Point clouds and the scene
+// graph, recorded through a command buffer, are drawn after the objects.
+struct Scene_data {
+    std::vector<std::unique_ptr<Renderable>> objects;
+    std::vector<std::unique_ptr<Point_cloud>> clouds;
+    std::vector<std::unique_ptr<Texture>> textures;
+    std::unique_ptr<Scene_graph> graph;
+    std::vector<Scene_graph::Node> joints;  // Nodes the animation moves
+    Command_buffer commands;
+};
+
+struct Scene {
+    const char* name;
+    int frames;
+    int ssaa_factor;
+    Renderer::Render_mode mode;
+    std::function<void(Renderer&, Scene_data&)> build;
+    std::function<void(Renderer&, Scene_data&, int frame)> animate;
+};
+
+// The rotating cube of the viewer
+static void build_cube(Renderer& renderer, Scene_data& data) {
+    auto cube = std::make_unique<Cube>();
+    cube->set_color(0xFFFF8040);
+    renderer.add_object(cube.get());
+    data.objects.push_back(std::move(cube));
+    renderer.set_camera(Vec3(0, 0, 5), Vec3(0, 0, 0), Vec3(0, 1, 0));
+}
+
+static void animate_cube(Renderer&, Scene_data& data, int frame) {
+    float angle = frame * 0.02f;
+    static_cast<Cube*>(data.objects[0].get())->set_rotation(Vec3(-angle, -angle, 0));
+}
+
+// 100 x 100 low poly spheres, all sharing one cached mesh
+static void build_sphere_grid(Renderer& renderer, Scene_data& data) {
+    for (int y = 0; y < 100; ++y) {
+        for (int x = 0; x < 100; ++x) {
+            auto sphere = std::make_unique<Sphere>(0.4f, 8, 8);
+            sphere->set_position(Vec3(x - 49.5f, y - 49.5f, 0.0f));
+            sphere->set_color(0xFF000000 | uint32_t(x * 2 + 50) << 16 | uint32_t(y * 2 + 50) << 8 | 0xC0);
+            renderer.add_object(sphere.get());
+            data.objects.push_back(std::move(sphere));
+        }
+    }
+}
+
+static void animate_sphere_grid(Renderer& renderer, Scene_data&, int frame) {
+    float angle = frame * 0.01f;
+    renderer.set_camera(Vec3(70.0f * std::sin(angle), 0, 70.0f * std::cos(angle)), Vec3(0, 0, 0), Vec3(0, 1, 0));
+}
+
+// Camera inside a large sphere among cubes crossing the near plane
+static void build_clip_inside(Renderer& renderer, Scene_data& data) {
+    auto room = std::make_unique<Sphere>(10.0f, 32, 32);
+    room->set_color(0xFF6080A0);
+    renderer.add_object(room.get());
+    data.objects.push_back(std::move(room));
+
+    for (int i = 0; i < 16; ++i) {
+        float a = i * 0.3927f;
+        auto cube = std::make_unique<Cube>();
+        cube->set_position(Vec3(1.5f * std::cos(a), 0.4f * (i % 4) - 0.6f, 1.5f * std::sin(a)));
+        cube->set_scale(Vec3(2.5f, 0.3f, 2.5f));
+        cube->set_rotation(Vec3(0, a, 0));
+        cube->set_color(0xFF000000 | uint32_t(i * 15 + 30) << 16 | 0x8000 | uint32_t(255 - i * 15));
+        renderer.add_object(cube.get());
+        data.objects.push_back(std::move(cube));
+    }
+}
+
+static void animate_clip_inside(Renderer& renderer, Scene_data&, int frame) {
+    float angle = frame * 0.05f;
+    renderer.set_camera(Vec3(0, 0, 0), Vec3(std::sin(angle), 0.2f, std::cos(angle)), Vec3(0, 1, 0));
+}
+
+// Cube in front of a sphere, rendered at every SSAA factor
+static void build_ssaa(Renderer& renderer, Scene_data& data) {
+    auto sphere = std::make_unique<Sphere>(1.0f, 24, 24);
+    sphere->set_position(Vec3(1.0f, 0, -0.5f));
+    sphere->set_color(0xFF40A0FF);
+    renderer.add_object(sphere.get());
+    data.objects.push_back(std::move(sphere));
+    build_cube(renderer, data);
+}
+
+static void animate_ssaa(Renderer&, Scene_data& data, int frame) {
+    float angle = frame * 0.02f;
+    static_cast<Cube*>(data.objects[1].get())->set_rotation(Vec3(-angle, -angle, 0));
+}
+
+// The SSAA scene as side by side stereo views
+static void build_stereo(Renderer& renderer, Scene_data& data) {
+    build_ssaa(renderer, data);
+
+    Mat4 projection = Mat4::perspective(3.14159f / 3.0f, (WIDTH / 2.0f) / HEIGHT, 0.1f, 100.0f);
+    Renderer::View left{Mat4::look_at(Vec3(-0.1f, 0, 5), Vec3(0, 0, 0), Vec3(0, 1, 0)), projection, 0, 0, WIDTH / 2, HEIGHT};
+    Renderer::View right{Mat4::look_at(Vec3(0.1f, 0, 5), Vec3(0, 0, 0), Vec3(0, 1, 0)), projection, WIDTH / 2, 0, WIDTH / 2, HEIGHT};
+    renderer.set_views({left, right});
+}
+
+// Static grid of spheres with one small rotating cube in front, most of the frame never changes
+static void build_dashboard(Renderer& renderer, Scene_data& data) {
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 12; ++x) {
+            auto sphere = std::make_unique<Sphere>(0.35f, 16, 16);
+            sphere->set_position(Vec3(x - 5.5f, y - 3.5f, -2.0f));
+            sphere->set_color(0xFF000000 | uint32_t(x * 16 + 60) << 16 | uint32_t(y * 20 + 60) << 8 | 0xA0);
+            renderer.add_object(sphere.get());
+            data.objects.push_back(std::move(sphere));
+        }
+    }
+
+    auto cube = std::make_unique<Cube>();
+    cube->set_position(Vec3(0, 0, 2.0f));
+    cube->set_scale(Vec3(0.5f, 0.5f, 0.5f));
+    cube->set_color(0xFFFF8040);
+    renderer.add_object(cube.get());
+    data.objects.push_back(std::move(cube));
+    renderer.set_camera(Vec3(0, 0, 8), Vec3(0, 0, 0), Vec3(0, 1, 0));
+}
+
+static void animate_dashboard(Renderer&, Scene_data& data, int frame) {
+    float angle = frame * 0.02f;
+    static_cast<Cube*>(data.objects.back().get())->set_rotation(Vec3(-angle, -angle, 0));
+}
+
+// 2M point scan of a wavy surface, colored by height, with the cube sinking into it
+static void build_point_cloud(Renderer& renderer, Scene_data& data) {
+    const int side = 1414;
+    std::vector<Vec3> positions;
+    std::vector<uint32_t> colors;
+    positions.reserve(size_t(side) * side);
+    colors.reserve(size_t(side) * side);
+
+    // Jittered grid, xorshift keeps it identical on every platform
+    uint32_t state = 2463534242u;
+    auto jitter = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return (state & 0xFFFF) / 65535.0f - 0.5f;
+    };
+    for (int i = 0; i < side; ++i) {
+        for (int j = 0; j < side; ++j) {
+            float x = (i + jitter()) / side * 8.0f - 4.0f;
+            float z = (j + jitter()) / side * 8.0f - 4.0f;
+            float y = 0.3f * std::sin(x * 2.0f) * std::cos(z * 1.5f) - 0.5f;
+            uint32_t shade = uint32_t((y + 0.8f) / 0.6f * 200.0f) + 40;
+            positions.push_back(Vec3(x, y, z));
+            colors.push_back(0xFF000000 | shade << 16 | (255 - shade) << 8 | 0x60);
+        }
+    }
+    data.clouds.push_back(std::make_unique<Point_cloud>(std::move(positions), std::move(colors)));
+
+    build_cube(renderer, data);
+    renderer.set_camera(Vec3(0, 2.5f, 6), Vec3(0, -0.5f, 0), Vec3(0, 1, 0));
+}
+
+static void animate_point_cloud(Renderer& renderer, Scene_data& data, int frame) {
+    animate_cube(renderer, data, frame);
+    data.clouds[0]->set_model_matrix(Mat4::rot_y(frame * 0.01f));
+}
+
+// Rotating bilinear textured cubes over a nearest sampled floor stretching into
+// the distance, textures are minified and seen at every orientation
+static void build_textured(Renderer& renderer, Scene_data& data) {
+    auto floor_texture = std::make_unique<Texture>(Texture::checkerboard(1024, 64, 0xFFE0E0E0, 0xFF404040));
+    floor_texture->set_filter(Texture::Filter::Nearest);
+    auto cube_texture = std::make_unique<Texture>(Texture::checkerboard(512, 8, 0xFFFFFFFF, 0xFFFF8040));
+
+    auto floor = std::make_unique<Cube>();
+    floor->set_position(Vec3(0, -1.5f, -10.0f));
+    floor->set_scale(Vec3(30.0f, 0.1f, 30.0f));
+    floor->set_texture(floor_texture.get());
+    renderer.add_object(floor.get());
+    data.objects.push_back(std::move(floor));
+
+    for (int z = 0; z < 4; ++z) {
+        for (int x = 0; x < 3; ++x) {
+            auto cube = std::make_unique<Cube>();
+            cube->set_position(Vec3((x - 1) * 2.5f, 0, -z * 4.0f));
+            cube->set_color(0xFF000000 | uint32_t(255 - z * 30) << 16 | uint32_t(200 + x * 25) << 8 | 0xFF);
+            cube->set_texture(cube_texture.get());
+            renderer.add_object(cube.get());
+            data.objects.push_back(std::move(cube));
+        }
+    }
+    data.textures.push_back(std::move(floor_texture));
+    data.textures.push_back(std::move(cube_texture));
+    renderer.set_camera(Vec3(0, 1.0f, 6), Vec3(0, -0.5f, 0), Vec3(0, 1, 0));
+}
+
+static void animate_textured(Renderer&, Scene_data& data, int frame) {
+    for (size_t i = 1; i < data.objects.size(); ++i) {
+        float angle = frame * 0.02f + i * 0.5f;
+        static_cast<Cube*>(data.objects[i].get())->set_rotation(Vec3(-angle, -angle * 0.7f, 0));
+    }
+}
+
+// Articulated rig in the scene graph, four arms of five joints with three
+// fingers each on a static field of 400 spheres. Only one arm moves per frame,
+// so an update recomputes a few of the graph's nodes.
+static void build_rig(Renderer& renderer, Scene_data& data) {
+    auto sphere = std::make_unique<Sphere>(0.15f, 8, 8);
+    sphere->set_color(0xFF4060A0);
+    auto segment = std::make_unique<Cube>();
+    segment->set_color(0xFFE0A040);
+    auto finger = std::make_unique<Cube>();
+    finger->set_color(0xFFFF6040);
+
+    data.graph = std::make_unique<Scene_graph>();
+    Scene_graph& graph = *data.graph;
+    Scene_graph::Node field = graph.add_node(Scene_graph::NONE, Mat4::translation(0, -1.5f, -4.0f));
+    for (int z = 0; z < 20; ++z) {
+        for (int x = 0; x < 20; ++x) {
+            Scene_graph::Node node = graph.add_node(field, Mat4::translation((x - 9.5f) * 0.5f, 0, (z - 9.5f) * 0.5f));
+            graph.set_mesh(node, sphere.get());
+        }
+    }
+
+    // Arms are added a level at a time, which exercises out of order insertion
+    Scene_graph::Node body = graph.add_node(Scene_graph::NONE, Mat4::translation(0, -1.0f, -3.0f));
+    std::vector<Scene_graph::Node> tips;
+    for (int arm = 0; arm < 4; ++arm) tips.push_back(graph.add_node(body, Mat4::rot_y(arm * 1.5708f)));
+    for (int joint = 0; joint < 5; ++joint) {
+        for (Scene_graph::Node& tip : tips) {
+            Scene_graph::Node node = graph.add_node(tip, Mat4::translation(joint ? 0.6f : 0.3f, 0, 0));
+            Scene_graph::Node shape = graph.add_node(node, Mat4::translation(0.3f, 0, 0) * Mat4::scale(0.6f, 0.2f, 0.2f));
+            graph.set_mesh(shape, segment.get());
+            data.joints.push_back(node);
+            tip = node;
+        }
+    }
+    for (Scene_graph::Node tip : tips) {
+        for (int k = 0; k < 3; ++k) {
+            Scene_graph::Node node = graph.add_node(tip, Mat4::translation(0.6f, 0, 0) * Mat4::rot_y((k - 1) * 0.5f) *
+                                                         Mat4::translation(0.15f, 0, 0) * Mat4::scale(0.3f, 0.08f, 0.08f));
+            graph.set_mesh(node, finger.get());
+        }
+    }
+
+    data.objects.push_back(std::move(sphere));
+    data.objects.push_back(std::move(segment));
+    data.objects.push_back(std::move(finger));
+    renderer.set_camera(Vec3(0, 2.0f, 4.0f), Vec3(0, -1.0f, -3.0f), Vec3(0, 1, 0));
+}
+
+static void animate_rig(Renderer&, Scene_data& data, int frame) {
+    // Joints are stored joint major, the arm of this frame bends every joint
+    size_t arm = size_t(frame / 30) % 4;
+    float angle = 0.3f * std::sin(frame * 0.1f);
+    for (size_t joint = 0; joint < 5; ++joint) {
+        Mat4 offset = Mat4::translation(joint ? 0.6f : 0.3f, 0, 0);
+        data.graph->set_local(data.joints[joint * 4 + arm], offset * Mat4::rot_z(angle) * Mat4::rot_y(angle * 0.5f));
+    }
+}
+
+// Write width x height ARGB pixels as binary PPM
+static bool write_ppm(const std::string& path, const uint32_t* pixels, int width, int height) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<uint8_t> row(width * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint32_t c = pixels[y * width + x];
+            row[x * 3 + 0] = uint8_t(c >> 16);
+            row[x * 3 + 1] = uint8_t(c >> 8);
+            row[x * 3 + 2] = uint8_t(c);
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+
+    return std::fclose(file) == 0;
+}
+
+// Largest channel difference between pixels and a stored PPM, -1 if it can't be read
+static int compare_ppm(const std::string& path, const uint32_t* pixels, int width, int height) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return -1;
+
+    int w = 0, h = 0, max = 0;
+    if (std::fscanf(file, "P6 %d %d %d", &w, &h, &max) != 3 || w != width || h != height || max != 255) {
+        std::fclose(file);
+        return -1;
+    }
+    std::fgetc(file); // Single whitespace after the header
+
+    std::vector<uint8_t> data(size_t(width) * height * 3);
+    bool ok = std::fread(data.data(), 1, data.size(), file) == data.size();
+    std::fclose(file);
+    if (!ok) return -1;
+
+    int diff = 0;
+    for (size_t i = 0; i < size_t(width) * height; ++i) {
+        uint32_t c = pixels[i];
+        diff = std::max(diff, std::abs(int((c >> 16) & 0xFF) - data[i * 3 + 0]));
+        diff = std::max(diff, std::abs(int((c >> 8) & 0xFF) - data[i * 3 + 1]));
+        diff = std::max(diff, std::abs(int(c & 0xFF) - data[i * 3 + 2]));
+    }
+    return diff;
+}
+
+// Golden hashes, one "name hash" per line, # starts a comment
+static std::map<std::string, uint64_t> load_golden(const std::string& path) {
+    std::map<std::string, uint64_t> golden;
+    FILE* file = std::fopen(path.c_str(), "r");
+    if (!file) return golden;
+
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        char name[128];
+        unsigned long long hash;
+        if (line[0] == '#') continue;
+        if (std::sscanf(line, "%127s %llx", name, &hash) == 2) golden[name] = hash;
+    }
+
+    std::fclose(file);
+    return golden;
+}
+
+int main(int argc, char** argv) {
+    const char* only = nullptr;
+    int threads = 1; // Geometry stage workers, 0 for all cores
+    std::string golden_path = POLYRENDER_BENCH_GOLDEN;
+    std::string images;
+    bool update = false;
+    bool tiled = false;
+    bool dirty = false;
+    int tolerance = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) only = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--tiled") == 0) tiled = true;
+        else if (std::strcmp(argv[i], "--dirty") == 0) dirty = true;
+        else if (std::strcmp(argv[i], "--golden") == 0 && i + 1 < argc) golden_path = argv[++i];
+        else if (std::strcmp(argv[i], "--images") == 0 && i + 1 < argc) images = argv[++i];
+        else if (std::strcmp(argv[i], "--update") == 0) update = true;
+        else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = std::max(0, std::atoi(argv[++i]));
+        else {
+            std::fprintf(stderr, "Usage: %s [--scene <name>] [--threads N] [--tiled] [--dirty] [--golden <file>] [--update] "
+                                 "[--images <dir>] [--tolerance N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    using Mode = Renderer::Render_mode;
+    const std::vector<Scene> scenes = {
+        {"cube_wireframe", 240, 1, Mode::Wireframe, build_cube, animate_cube},
+        {"cube_filled", 240, 1, Mode::Filled, build_cube, animate_cube},
+        {"sphere_grid_10k", 10, 1, Mode::Filled, build_sphere_grid, animate_sphere_grid},
+        {"clip_inside", 60, 1, Mode::Filled, build_clip_inside, animate_clip_inside},
+        {"ssaa_1", 30, 1, Mode::Filled, build_ssaa, animate_ssaa},
+        {"ssaa_2", 30, 2, Mode::Filled, build_ssaa, animate_ssaa},
+        {"ssaa_3", 30, 3, Mode::Filled, build_ssaa, animate_ssaa},
+        {"ssaa_4", 30, 4, Mode::Filled, build_ssaa, animate_ssaa},
+        {"stereo", 60, 1, Mode::Filled, build_stereo, animate_ssaa},
+        {"dashboard", 240, 1, Mode::Filled, build_dashboard, animate_dashboard},
+        {"point_cloud_2m", 30, 1, Mode::Filled, build_point_cloud, animate_point_cloud},
+        {"textured", 120, 1, Mode::Filled, build_textured, animate_textured},
+        {"scene_graph_rig", 240, 1, Mode::Filled, build_rig, animate_rig},
+    };
+
+    std::map<std::string, uint64_t> golden = update ? std::map<std::string, uint64_t>() : load_golden(golden_path);
+    std::map<std::string, uint64_t> results;
+
+    std::unique_ptr<Job_system> jobs;
+    if (threads != 1) jobs = std::make_unique<Job_system>(unsigned(threads));
+
+#ifdef POLYRENDER_PROFILE
+    std::printf("%-16s %7s %9s %10s", "scene", "frames", "fps", "ms/frame");
+    for (int s = 0; s < static_cast<int>(Stage::Count); ++s) std::printf(" %9s", Frame_stats::name(static_cast<Stage>(s)));
+    std::printf("  %-16s %s\n", "hash", "golden");
+#else
+    std::printf("%-16s %7s %9s %10s  %-16s %s\n", "scene", "frames", "fps", "ms/frame", "hash", "golden");
+#endif
+
+    int failures = 0;
+    for (const Scene& scene : scenes) {
+        if (only && std::strcmp(only, scene.name) != 0) continue;
+
+        Renderer renderer(WIDTH, HEIGHT);
+        Scene_data data;
+        renderer.set_job_system(jobs.get());
+        renderer.enable_tiled_layout(tiled);
+        renderer.enable_dirty_regions(dirty);
+        renderer.set_projection(3.14159f / 3.0f, 0.1f, 100.0f);
+        renderer.set_render_mode(scene.mode);
+        if (scene.ssaa_factor > 1) renderer.enable_ssaa(scene.ssaa_factor);
+        scene.build(renderer, data);
+
+        double stage_ms[static_cast<int>(Stage::Count)] = {};
+        uint64_t hash = 14695981039346656037ull;
+        size_t graph_updated = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < scene.frames; ++f) {
+            scene.animate(renderer, data, f);
+            renderer.clear(0xFF000000);
+            renderer.render();
+            for (const auto& cloud : data.clouds) renderer.render_points(*cloud);
+            if (data.graph) {
+                data.graph->update();
+                graph_updated += data.graph->get_updated_count();
+                data.commands.reset();
+                data.graph->record(data.commands.list(0));
+                data.commands.submit(renderer);
+            }
+            renderer.show();
+
+            hash = (hash ^ renderer.framebuffer_checksum()) * 1099511628211ull;
+            for (int s = 0; s < static_cast<int>(Stage::Count); ++s) stage_ms[s] += renderer.get_stats().stage_ms[s];
+        }
+        double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        results[scene.name] = hash;
+
+        // Compare against golden hash, fall back to the stored image with a tolerance
+        std::string image = images.empty() ? std::string() : images + "/" + scene.name + ".ppm";
+        std::string verdict;
+        if (update) {
+            verdict = "updated";
+            if (!image.empty() && !write_ppm(image, renderer.get_framebuffer(), WIDTH, HEIGHT)) {
+                std::fprintf(stderr, "[Error] Could not write %s\n", image.c_str());
+                failures++;
+            }
+        } else if (!golden.count(scene.name)) {
+            verdict = "missing";
+            failures++;
+        } else if (golden[scene.name] == hash) {
+            verdict = "identical";
+        } else {
+            int diff = image.empty() ? -1 : compare_ppm(image, renderer.get_framebuffer(), WIDTH, HEIGHT);
+            if (diff >= 0 && diff <= tolerance) {
+                verdict = "within tolerance, max diff " + std::to_string(diff);
+            } else {
+                verdict = diff < 0 ? "MISMATCH" : "MISMATCH, max diff " + std::to_string(diff);
+                failures++;
+            }
+        }
+
+        std::printf("%-16s %7d %9.1f %10.3f", scene.name, scene.frames, 1000.0 * scene.frames / total_ms, total_ms / scene.frames);
+#ifdef POLYRENDER_PROFILE
+        for (double ms : stage_ms) std::printf(" %9.3f", ms / scene.frames);
+#endif
+        std::printf("  %016llx %s\n", static_cast<unsigned long long>(hash), verdict.c_str());
+        if (data.graph) {
+            std::printf("%-16s %.1f of %zu nodes updated per frame\n", "", double(graph_updated) / scene.frames,
+                        data.graph->get_node_count());
+        }
+    }
+
+    if (update) {
+        FILE* file = std::fopen(golden_path.c_str(), "w");
+        if (!file) {
+            std::fprintf(stderr, "[Error] Could not write %s\n", golden_path.c_str());
+            return 1;
+        }
+        std::fprintf(file, "# Golden frame hashes of Polyrender_bench, FNV-1a over the checksums of every frame\n");
+        for (const auto& result : results) {
+            std::fprintf(file, "%s %016llx\n", result.first.c_str(), static_cast<unsigned long long>(result.second));
+        }
+        std::fclose(file);
+    }
+
+    return failures ? 1 : 0;
+}
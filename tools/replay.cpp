@@ -0,0 +1,267 @@
+// Headless replay of a capture file for performance regression runs.
+// Renders every captured frame as fast as possible and reports per frame
+// timings and a checksum of the resolved image. With --frame-parallel N frames
+// render concurrently on N contexts and only batch throughput is reported.
+// --quantize draws every mesh from 16 bit quantized positions and indices.
+// --overdraw renders depth complexity heatmaps and reports fill cost, it needs
+// a build configured with POLYRENDER_OVERDRAW.
+//
+// Usage: Polyrender_replay <capture> [--repeat N] [--quiet] [--visibility] [--aa-lines] [--tiled] [--quantize] [--threads N]
+//                          [--frame-parallel N] [--dump <file>] [--overdraw]
+
+#include "Renderer.hpp"
+#include "Capture.hpp"
+#include "Mesh_instance.hpp"
+#include "Quantized_mesh.hpp"
+#include "Frame_writer.hpp"
+#include "Offline_renderer.hpp"
+#include "Alloc_counter.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+// Point renderer at the objects and settings of a captured frame. Instances are
+// reused between frames so steady state replay doesn't allocate. Meshes are
+// drawn from quantized unless it is empty.
+static void setup_frame(const Capture& capture, const Capture_frame& frame, Renderer& renderer,
+                        std::vector<std::unique_ptr<Mesh_instance>>& instances,
+                        const std::vector<Quantized_mesh>& quantized) {
+    renderer.clear_objects();
+    for (size_t i = 0; i < frame.objects.size(); ++i) {
+        uint32_t id = frame.objects[i].mesh;
+        const Capture_mesh& mesh = capture.meshes[id];
+        Mesh_instance instance = quantized.empty() ? Mesh_instance(mesh.vertices, mesh.indices)
+                                                   : Mesh_instance(quantized[id]);
+        if (i >= instances.size()) instances.push_back(std::make_unique<Mesh_instance>(instance));
+        else *instances[i] = instance;
+        instances[i]->set_normals(mesh.normals);
+        instances[i]->set_colors(mesh.colors);
+        instances[i]->set_model_matrix(frame.objects[i].model);
+        instances[i]->set_color(frame.objects[i].color);
+        renderer.add_object(instances[i].get());
+    }
+
+    if (renderer.get_ssaa_factor() != frame.ssaa_factor) renderer.enable_ssaa(frame.ssaa_factor);
+    if (renderer.get_render_scale() != frame.render_scale) renderer.set_render_scale(frame.render_scale);
+
+    renderer.set_render_mode(static_cast<Renderer::Render_mode>(frame.render_mode));
+    renderer.set_shade_mode(static_cast<Renderer::Shade_mode>(frame.shade_mode));
+    renderer.set_light(frame.light_dir, frame.ambient);
+}
+
+// Draw a frame set up by setup_frame, show() is left to the caller
+static void draw_frame(const Capture_frame& frame, Renderer& renderer) {
+    renderer.set_view_matrix(frame.view);
+    renderer.set_projection_matrix(frame.projection);
+    renderer.clear(frame.clear_color);
+    renderer.render();
+}
+
+// Settings shared by every render context
+static void prepare_renderer(const Capture& capture, Renderer& renderer, bool visibility, bool aa_lines,
+                             bool tiled, bool overdraw) {
+    renderer.enable_visibility_buffer(visibility);
+    renderer.enable_aa_lines(aa_lines);
+    renderer.enable_tiled_layout(tiled);
+    renderer.enable_overdraw(overdraw);
+    renderer.reserve_render_target(capture.ssaa_factor);
+    for (const auto& frame : capture.frames) renderer.reserve_render_target(frame.ssaa_factor);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <capture> [--repeat N] [--quiet] [--visibility] [--aa-lines] [--tiled] [--quantize] [--threads N] "
+                             "[--frame-parallel N] [--dump <file>] [--overdraw]\n", argv[0]);
+        return 1;
+    }
+
+    int repeat = 1;
+    bool quiet = false;
+    bool visibility = false;
+    bool aa_lines = false;
+    bool tiled = false;
+    bool quantize = false;
+    bool overdraw = false;
+    int threads = 1; // Geometry stage workers, 0 for all cores
+    int frame_parallel = 1; // Frames in flight, 0 for all cores
+    const char* dump_path = nullptr; // Frames of the first run, format from the extension
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--quiet") == 0) quiet = true;
+        else if (std::strcmp(argv[i], "--visibility") == 0) visibility = true;
+        else if (std::strcmp(argv[i], "--aa-lines") == 0) aa_lines = true;
+        else if (std::strcmp(argv[i], "--tiled") == 0) tiled = true;
+        else if (std::strcmp(argv[i], "--quantize") == 0) quantize = true;
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--frame-parallel") == 0 && i + 1 < argc) frame_parallel = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--dump") == 0 && i + 1 < argc) dump_path = argv[++i];
+        else if (std::strcmp(argv[i], "--overdraw") == 0) overdraw = true;
+    }
+
+#ifndef POLYRENDER_OVERDRAW
+    if (overdraw) {
+        std::fprintf(stderr, "[Error] --overdraw needs a build configured with -DPOLYRENDER_OVERDRAW=ON\n");
+        return 1;
+    }
+#endif
+
+    Capture capture;
+    if (!capture.load(argv[1])) {
+        std::fprintf(stderr, "[Error] Could not load capture %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<Quantized_mesh> quantized;
+    if (quantize) {
+        size_t float_bytes = 0, packed_bytes = 0;
+        for (const Capture_mesh& mesh : capture.meshes) {
+            quantized.emplace_back(mesh.vertices, mesh.indices);
+            float_bytes += mesh.vertices.size() * sizeof(Vec3) + mesh.indices.size() * sizeof(uint32_t);
+            packed_bytes += quantized.back().get_memory();
+        }
+        std::printf("quantized meshes %zu KB, floats %zu KB\n", packed_bytes / 1024, float_bytes / 1024);
+    }
+
+    Frame_writer dump;
+    if (dump_path && !dump.open(dump_path, Frame_writer::format_from_path(dump_path), capture.width, capture.height)) {
+        std::fprintf(stderr, "[Error] Could not open dump output %s\n", dump_path);
+        return 1;
+    }
+
+    uint64_t sequence_hash = 14695981039346656037ull;
+    bool dump_failed = false;
+
+    // Fill cost summed over the frames of the first run
+    double complexity_sum = 0.0;
+    uint32_t complexity_max = 0;
+    uint64_t fragments_passed = 0, fragments_overwritten = 0;
+
+    // Checksum, print and dump a finished frame of the first run
+    auto finish_frame = [&](int run, size_t f, double ms, const Renderer& renderer) {
+        if (run != 0) return;
+        uint64_t checksum = renderer.framebuffer_checksum();
+        sequence_hash = (sequence_hash ^ checksum) * 1099511628211ull;
+        if (!quiet) {
+            if (ms >= 0.0) std::printf("frame %zu %.3f ms %016llx\n", f, ms, static_cast<unsigned long long>(checksum));
+            else std::printf("frame %zu %016llx\n", f, static_cast<unsigned long long>(checksum));
+        }
+        if (dump.is_open() && !dump.write(renderer)) dump_failed = true;
+
+        const Overdraw_stats& stats = renderer.get_overdraw_stats();
+        complexity_sum += stats.average_complexity();
+        complexity_max = std::max(complexity_max, stats.max_complexity);
+        fragments_passed += stats.passed;
+        fragments_overwritten += stats.overwritten;
+    };
+
+    std::vector<double> times;
+    double batch_ms = 0.0;
+
+    // Heap allocations of the runs after the first, which warms up every buffer
+    uint64_t steady_allocations = 0;
+    auto count_allocations = [&](int run, uint64_t before) {
+        if (run > 0) steady_allocations += allocation_count() - before;
+    };
+
+    if (frame_parallel != 1) {
+        // Independent frames on their own contexts, geometry runs serially in each
+        Offline_renderer offline(capture.width, capture.height, unsigned(frame_parallel));
+        for (unsigned c = 0; c < offline.get_context_count(); ++c) prepare_renderer(capture, offline.get_context(c), visibility, aa_lines, tiled, overdraw);
+        std::vector<std::vector<std::unique_ptr<Mesh_instance>>> instances(offline.get_context_count());
+
+        for (int r = 0; r < repeat; ++r) {
+            uint64_t allocations = allocation_count();
+            auto start = std::chrono::steady_clock::now();
+            offline.render(capture.frames.size(),
+                [&](size_t f, unsigned context, Renderer& renderer) {
+                    setup_frame(capture, capture.frames[f], renderer, instances[context], quantized);
+                    draw_frame(capture.frames[f], renderer);
+                },
+                [&](size_t f, const Renderer& renderer) {
+                    finish_frame(r, f, -1.0, renderer);
+                });
+            batch_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            count_allocations(r, allocations);
+        }
+        std::printf("contexts %u\n", offline.get_context_count());
+    } else {
+        Renderer renderer(capture.width, capture.height);
+        prepare_renderer(capture, renderer, visibility, aa_lines, tiled, overdraw);
+
+        std::unique_ptr<Job_system> jobs;
+        if (threads != 1) {
+            jobs = std::make_unique<Job_system>(unsigned(threads));
+            renderer.set_job_system(jobs.get());
+        }
+
+        // Instances are reused across frames and set up outside the timed section
+        std::vector<std::unique_ptr<Mesh_instance>> instances;
+        times.reserve(capture.frames.size() * repeat);
+
+        for (int r = 0; r < repeat; ++r) {
+            uint64_t allocations = allocation_count();
+            for (size_t f = 0; f < capture.frames.size(); ++f) {
+                const Capture_frame& frame = capture.frames[f];
+                setup_frame(capture, frame, renderer, instances, quantized);
+
+                auto start = std::chrono::steady_clock::now();
+                draw_frame(frame, renderer);
+                renderer.show();
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                times.push_back(ms);
+                batch_ms += ms;
+
+                finish_frame(r, f, ms, renderer);
+            }
+            count_allocations(r, allocations);
+        }
+    }
+
+    if (dump.is_open()) {
+        if (!dump.close() || dump_failed) {
+            std::fprintf(stderr, "[Error] Writing %s failed\n", dump_path);
+            return 1;
+        }
+        std::printf("dumped %llu frames, %llu stalls\n", static_cast<unsigned long long>(dump.get_frames_written()),
+                    static_cast<unsigned long long>(dump.get_stalls()));
+    }
+
+    size_t frame_count = capture.frames.size() * repeat;
+    if (frame_count == 0) {
+        std::printf("capture has no frames\n");
+        return 0;
+    }
+
+    if (times.empty()) {
+        std::printf("frames %zu  total %.3f ms  fps %.1f\n", frame_count, batch_ms, 1000.0 * frame_count / batch_ms);
+    } else {
+        std::vector<double> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+
+        std::printf("frames %zu  mean %.3f ms  min %.3f ms  p50 %.3f ms  p95 %.3f ms  max %.3f ms  fps %.1f\n",
+                    times.size(), batch_ms / times.size(), sorted.front(),
+                    sorted[sorted.size() / 2], sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)],
+                    sorted.back(), 1000.0 * times.size() / batch_ms);
+    }
+    std::printf("checksum %016llx\n", static_cast<unsigned long long>(sequence_hash));
+    if (overdraw) {
+        std::printf("depth complexity mean %.2f  max %u  overwritten %.1f%% of written fragments\n",
+                    complexity_sum / capture.frames.size(), complexity_max,
+                    fragments_passed ? 100.0 * fragments_overwritten / fragments_passed : 0.0);
+    }
+
+#ifdef POLYRENDER_COUNT_ALLOCS
+    if (repeat > 1) {
+        size_t steady_frames = capture.frames.size() * (repeat - 1);
+        std::printf("allocations %llu in %zu steady state frames\n",
+                    static_cast<unsigned long long>(steady_allocations), steady_frames);
+    }
+#endif
+
+    return 0;
+}